@@ -0,0 +1,2109 @@
+#include "FanOut.h"
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <deque>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+#include <CxxPtr/GlibPtr.h>
+#include <CxxPtr/GstPtr.h>
+
+#include "RtpHelpers.h"
+
+
+namespace {
+
+enum {
+    DEFAULT_MAX_SIZE_BUFFERS = 200,
+    // after that amount of items worker lets other pads go first
+    MAX_ITEMS_PER_RUN = 64,
+    // rates in "stats" are averaged over that period
+    STATS_WINDOW_SECONDS = 5,
+    // frame accumulated into list is dispatched anyway after that amount of packets
+    MAX_FRAME_LIST_SIZE = 256,
+};
+
+enum {
+    DEFAULT_PACING_MAX_DELAY_MS = 50,
+    // pacer lets that much data go at once
+    PACING_BURST_USEC = 5000,
+    PACING_MIN_BURST_BYTES = 1500,
+    // pad bitrate is measured over windows of that length
+    PACING_RATE_WINDOW_USEC = G_USEC_PER_SEC,
+    // buffers pushed closer to each other are counted as one burst
+    BURST_GAP_USEC = 1000,
+};
+
+enum {
+    PROP_0,
+    PROP_NUM_SRC_PADS,
+    PROP_MAX_SIZE_BUFFERS,
+    PROP_GOP_CACHE_MAX_BYTES,
+    PROP_NUM_ACTIVE_SRC_PADS,
+    PROP_STATS,
+    PROP_FRAME_LISTS,
+    PROP_DROP,
+};
+
+enum {
+    PAD_PROP_0,
+    PAD_PROP_DIRECT,
+    PAD_PROP_DROPPED_FRAMES,
+    PAD_PROP_DROPPED_BUFFERS,
+    PAD_PROP_TIME_TO_FIRST_FRAME,
+    PAD_PROP_PAUSED,
+    PAD_PROP_HOLD,
+    PAD_PROP_DEGRADATION,
+    PAD_PROP_FILL_LEVEL,
+    PAD_PROP_MAX_SIZE_BUFFERS,
+    PAD_PROP_PACING_FACTOR,
+    PAD_PROP_PACING_MAX_DELAY,
+    PAD_PROP_PACED_BUFFERS,
+    PAD_PROP_PACING_DELAY,
+    PAD_PROP_MAX_PACING_DELAY,
+    PAD_PROP_MAX_BURST,
+    PAD_PROP_GOP_REPLAYS,
+    PAD_PROP_SKIPPED_GOP_REPLAYS,
+};
+
+enum {
+    // queue limit divider for FAN_OUT_PAD_DEGRADATION_REDUCED_QUEUE
+    REDUCED_QUEUE_DIVIDER = 4,
+};
+
+enum ItemFlags : guint8 {
+    ITEM_FRAME_START = 1 << 0,
+    ITEM_FRAME_END = 1 << 1,
+    ITEM_KEY_FRAME = 1 << 2,
+    // pushed only to deliver pending sticky events while pad waits for key frame
+    ITEM_STICKY_EVENTS_PROBE = 1 << 3,
+    // GOP cache copy, timestamps have to be rewritten before push
+    ITEM_REPLAYED = 1 << 4,
+};
+
+struct QueueItem
+{
+    GstMiniObject* object;
+    guint8 flags;
+    gint64 time; // of enqueue, set for paced buffers only
+};
+
+GstStaticPadTemplate SinkTemplate =
+    GST_STATIC_PAD_TEMPLATE("sink", GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+GstStaticPadTemplate SrcTemplate =
+    GST_STATIC_PAD_TEMPLATE("src_%u", GST_PAD_SRC, GST_PAD_REQUEST, GST_STATIC_CAPS_ANY);
+
+struct PadList
+{
+    PadList() = default;
+    PadList(const PadList&) = delete;
+    ~PadList() {
+        for(FanOutPad* pad: pads)
+            gst_object_unref(pad);
+    }
+
+    std::vector<FanOutPad*> pads;
+};
+
+typedef std::shared_ptr<const PadList> PadListPtr;
+
+void StoreStickyEvent(std::vector<GstEvent*>* events, GstEvent* event)
+{
+    for(GstEvent*& storedEvent: *events) {
+        if(GST_EVENT_TYPE(storedEvent) == GST_EVENT_TYPE(event)) {
+            gst_event_replace(&storedEvent, event);
+            return;
+        }
+    }
+
+    events->push_back(gst_event_ref(event));
+}
+
+void RemoveStickyEvent(std::vector<GstEvent*>* events, GstEventType type)
+{
+    for(auto it = events->begin(); it != events->end(); ++it) {
+        if(GST_EVENT_TYPE(*it) == type) {
+            gst_event_unref(*it);
+            events->erase(it);
+            return;
+        }
+    }
+}
+
+GThreadPool* WorkersPool() noexcept;
+
+GstMiniObject* NewStickyEventsProbe()
+{
+    return GST_MINI_OBJECT_CAST(
+        gst_event_new_custom(
+            GST_EVENT_CUSTOM_DOWNSTREAM,
+            gst_structure_new_empty("rtfanout-sticky-events")));
+}
+// pad is handed back to workers pool at deadline, reference is taken over
+void SchedulePacedPad(FanOutPad*, gint64 deadline) noexcept;
+
+std::atomic<guint64> PushedBytes { 0 };
+
+}
+
+
+struct FanOutPadPrivate
+{
+    ~FanOutPadPrivate() { clear(); }
+
+    void clear() {
+        for(QueueItem& item: items)
+            gst_mini_object_unref(item.object);
+        items.clear();
+        buffersCount = 0;
+        stickyEventsProbeQueued = false;
+        waitKeyFrame = true;
+    }
+
+    void dropBuffers() {
+        std::deque<QueueItem> events;
+        for(QueueItem& item: items) {
+            if(GST_IS_BUFFER(item.object))
+                gst_mini_object_unref(item.object);
+            else
+                events.push_back(item);
+        }
+        items.swap(events);
+        buffersCount = 0;
+    }
+
+    // drops queued packets of the frame which is not completely queued yet
+    void trimIncompleteFrame() {
+        std::deque<QueueItem> events;
+        while(!items.empty()) {
+            const QueueItem item = items.back();
+            if(!GST_IS_BUFFER(item.object)) {
+                events.push_front(item);
+                items.pop_back();
+                continue;
+            }
+
+            // replayed GOP is not counted in queue limit, so it's never trimmed
+            if((item.flags & ITEM_FRAME_END) || (item.flags & ITEM_REPLAYED))
+                break;
+
+            gst_mini_object_unref(item.object);
+            items.pop_back();
+            --buffersCount;
+            ++droppedBuffers;
+
+            if(item.flags & ITEM_FRAME_START)
+                break;
+        }
+
+        items.insert(items.end(), events.begin(), events.end());
+    }
+
+    std::mutex mutex;
+    std::deque<QueueItem> items;
+    guint buffersCount = 0;
+    guint maxSizeBuffers = DEFAULT_MAX_SIZE_BUFFERS;
+    bool scheduled = false;
+    bool flushing = true;
+
+    // new peer, or peer which is behind, gets nothing until next key frame
+    bool waitKeyFrame = true;
+    bool stickyEventsDelivered = false;
+    bool stickyEventsProbeQueued = false;
+
+    guint64 droppedFrames = 0;
+    guint64 droppedBuffers = 0;
+
+    // peer can't receive anything before link, so queue is not drained till that
+    bool linked = false;
+
+    // replayed GOP frames get consecutive RTP timestamps ending with the latest one,
+    // so peer decodes them at once instead of playing with GOP delay
+    guint replayFramesLeft = 0;
+    guint32 replayRtpTimestamp = 0;
+    GstClockTime replayPts = GST_CLOCK_TIME_NONE;
+    guint gopReplays = 0;
+    guint skippedGopReplays = 0;
+
+    gint64 requestTime = 0;
+    gint64 firstBufferTime = 0;
+
+    // session is kept, but no buffers are sent
+    bool paused = false;
+    // the same as paused, but pad is still counted as active:
+    // peer is not ready to take buffers yet, and pushing them would block worker
+    bool held = false;
+    // buffers dispatched before resume are either replayed from GOP cache or outdated
+    guint64 resumeSequence = 0;
+    // last buffer dispatched before pad was blocked (0 if nothing was pushed to peer),
+    // GOP started before that was (at least partially) received by peer already
+    guint64 blockSequence = 0;
+
+    FanOutPadDegradation degradation = FAN_OUT_PAD_DEGRADATION_NONE;
+
+    // buffers are spread at pacingFactor times measured bitrate (0 = no pacing),
+    // but none is held longer than pacingMaxDelay
+    gdouble pacingFactor = 0;
+    GstClockTime pacingMaxDelay = DEFAULT_PACING_MAX_DELAY_MS * GST_MSECOND;
+    gint64 rateWindowStart = 0;
+    guint64 rateWindowBytes = 0;
+    gdouble byteRate = 0; // bytes per second
+    gdouble tokens = 0; // bytes, negative while pacer holds queue
+    gint64 tokensTime = 0;
+    gint64 pacingWaitStart = 0;
+    gint64 lastPushTime = 0;
+    guint currentBurst = 0;
+
+    guint64 pacedBuffers = 0;
+    GstClockTime pacingDelay = 0;
+    GstClockTime maxPacingDelay = 0;
+    guint maxBurst = 0;
+
+    bool blocked() const {
+        return paused || held;
+    }
+
+    bool pacing() const {
+        return pacingFactor > 0;
+    }
+
+    QueueItem takeFront(gint64 now) {
+        const QueueItem item = items.front();
+        items.pop_front();
+        if(GST_IS_BUFFER(item.object)) {
+            if(!(item.flags & ITEM_REPLAYED))
+                --buffersCount;
+            if(!firstBufferTime)
+                firstBufferTime = g_get_monotonic_time();
+            if(item.time && now)
+                onPacedPush(gst_buffer_get_size(GST_BUFFER_CAST(item.object)), now);
+        }
+
+        return item;
+    }
+
+    // will be called for every accepted buffer while pacing
+    void updateByteRate(gsize size, gint64 now) {
+        if(!rateWindowStart)
+            rateWindowStart = now;
+
+        rateWindowBytes += size;
+
+        const gint64 elapsed = now - rateWindowStart;
+        if(elapsed < PACING_RATE_WINDOW_USEC)
+            return;
+
+        // long enough to include key frames, smoothed to not follow single GOP
+        const gdouble windowRate = gdouble(rateWindowBytes) * G_USEC_PER_SEC / elapsed;
+        byteRate = byteRate > 0 ? (byteRate * 3 + windowRate) / 4 : windowRate;
+
+        rateWindowStart = now;
+        rateWindowBytes = 0;
+    }
+
+    // token bucket: returns time (in microseconds) head buffer should wait before push
+    gint64 pacingWait(gint64 now) {
+        if(!pacing() || byteRate <= 0 || items.empty())
+            return 0;
+
+        const QueueItem& item = items.front();
+        if(!item.time || !GST_IS_BUFFER(item.object))
+            return 0;
+
+        const gdouble rate = byteRate * pacingFactor / G_USEC_PER_SEC; // bytes per microsecond
+        const gdouble burst = std::max<gdouble>(rate * PACING_BURST_USEC, PACING_MIN_BURST_BYTES);
+        tokens = tokensTime ? std::min(tokens + (now - tokensTime) * rate, burst) : burst;
+        tokensTime = now;
+
+        if(tokens >= 0)
+            return 0;
+
+        // added latency is bounded
+        const gint64 deadline = item.time + gint64(pacingMaxDelay / GST_USECOND);
+        if(now >= deadline) {
+            // debt is forgiven, otherwise every next buffer would wait for max delay
+            tokens = 0;
+            return 0;
+        }
+
+        if(!pacingWaitStart)
+            pacingWaitStart = now;
+
+        return std::min<gint64>(gint64(-tokens / rate) + 1, deadline - now);
+    }
+
+    // will be called for every buffer taken for push while pacing
+    void onPacedPush(gsize size, gint64 now) {
+        tokens -= size;
+
+        if(pacingWaitStart) {
+            const GstClockTime delay = (now - pacingWaitStart) * GST_USECOND;
+            ++pacedBuffers;
+            pacingDelay += delay;
+            maxPacingDelay = std::max(maxPacingDelay, delay);
+            pacingWaitStart = 0;
+        }
+
+        if(lastPushTime && now - lastPushTime < BURST_GAP_USEC)
+            ++currentBurst;
+        else
+            currentBurst = 1;
+        lastPushTime = now;
+        maxBurst = std::max(maxBurst, currentBurst);
+    }
+
+    guint effectiveMaxSizeBuffers() const {
+        if(degradation == FAN_OUT_PAD_DEGRADATION_NONE)
+            return maxSizeBuffers;
+
+        return std::max<guint>(maxSizeBuffers / REDUCED_QUEUE_DIVIDER, 1);
+    }
+
+    // pushed directly from streaming thread (required for sync sinks)
+    std::atomic<bool> direct { false };
+};
+
+struct _FanOutPad
+{
+    GstPad parent_instance;
+
+    FanOutPadPrivate* p;
+};
+
+G_DEFINE_TYPE(FanOutPad, fan_out_pad, GST_TYPE_PAD)
+
+static void fan_out_pad_set_blocked(FanOutPad*, bool FanOutPadPrivate::* flag, gboolean blocked);
+
+static void fan_out_pad_set_property(
+    GObject* object,
+    guint propId,
+    const GValue* value,
+    GParamSpec* pspec)
+{
+    FanOutPad* self = _FAN_OUT_PAD(object);
+
+    switch(propId) {
+    case PAD_PROP_DIRECT: {
+        self->p->direct = g_value_get_boolean(value);
+
+        // queue is never drained for direct pad
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        self->p->clear();
+        break;
+    }
+    case PAD_PROP_PAUSED:
+        fan_out_pad_set_blocked(self, &FanOutPadPrivate::paused, g_value_get_boolean(value));
+        break;
+    case PAD_PROP_HOLD:
+        fan_out_pad_set_blocked(self, &FanOutPadPrivate::held, g_value_get_boolean(value));
+        break;
+    case PAD_PROP_DEGRADATION: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        self->p->degradation = static_cast<FanOutPadDegradation>(g_value_get_uint(value));
+        break;
+    }
+    case PAD_PROP_MAX_SIZE_BUFFERS: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        self->p->maxSizeBuffers = g_value_get_uint(value);
+        break;
+    }
+    case PAD_PROP_PACING_FACTOR: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        self->p->pacingFactor = g_value_get_double(value);
+        break;
+    }
+    case PAD_PROP_PACING_MAX_DELAY: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        self->p->pacingMaxDelay = g_value_get_uint64(value);
+        break;
+    }
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, propId, pspec);
+        break;
+    }
+}
+
+static void fan_out_pad_get_property(
+    GObject* object,
+    guint propId,
+    GValue* value,
+    GParamSpec* pspec)
+{
+    FanOutPad* self = _FAN_OUT_PAD(object);
+
+    switch(propId) {
+    case PAD_PROP_DIRECT:
+        g_value_set_boolean(value, self->p->direct);
+        break;
+    case PAD_PROP_DROPPED_FRAMES: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint64(value, self->p->droppedFrames);
+        break;
+    }
+    case PAD_PROP_DROPPED_BUFFERS: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint64(value, self->p->droppedBuffers);
+        break;
+    }
+    case PAD_PROP_PAUSED: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_boolean(value, self->p->paused);
+        break;
+    }
+    case PAD_PROP_HOLD: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_boolean(value, self->p->held);
+        break;
+    }
+    case PAD_PROP_DEGRADATION: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint(value, self->p->degradation);
+        break;
+    }
+    case PAD_PROP_FILL_LEVEL: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint(value, self->p->buffersCount * 100 / self->p->effectiveMaxSizeBuffers());
+        break;
+    }
+    case PAD_PROP_MAX_SIZE_BUFFERS: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint(value, self->p->maxSizeBuffers);
+        break;
+    }
+    case PAD_PROP_TIME_TO_FIRST_FRAME: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint64(
+            value,
+            self->p->firstBufferTime ?
+                (self->p->firstBufferTime - self->p->requestTime) * GST_USECOND :
+                0);
+        break;
+    }
+    case PAD_PROP_PACING_FACTOR: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_double(value, self->p->pacingFactor);
+        break;
+    }
+    case PAD_PROP_PACING_MAX_DELAY: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint64(value, self->p->pacingMaxDelay);
+        break;
+    }
+    case PAD_PROP_PACED_BUFFERS: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint64(value, self->p->pacedBuffers);
+        break;
+    }
+    case PAD_PROP_PACING_DELAY: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint64(value, self->p->pacingDelay);
+        break;
+    }
+    case PAD_PROP_MAX_PACING_DELAY: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint64(value, self->p->maxPacingDelay);
+        break;
+    }
+    case PAD_PROP_MAX_BURST: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint(value, self->p->maxBurst);
+        break;
+    }
+    case PAD_PROP_GOP_REPLAYS: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint(value, self->p->gopReplays);
+        break;
+    }
+    case PAD_PROP_SKIPPED_GOP_REPLAYS: {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        g_value_set_uint(value, self->p->skippedGopReplays);
+        break;
+    }
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, propId, pspec);
+        break;
+    }
+}
+
+static void fan_out_pad_finalize(GObject* object)
+{
+    FanOutPad* self = _FAN_OUT_PAD(object);
+
+    delete self->p;
+    self->p = nullptr;
+
+    G_OBJECT_CLASS(fan_out_pad_parent_class)->finalize(object);
+}
+
+static void fan_out_pad_class_init(FanOutPadClass* klass)
+{
+    GObjectClass* objectClass = G_OBJECT_CLASS(klass);
+
+    objectClass->set_property = fan_out_pad_set_property;
+    objectClass->get_property = fan_out_pad_get_property;
+    objectClass->finalize = fan_out_pad_finalize;
+
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_DIRECT,
+        g_param_spec_boolean(
+            "direct", "Direct",
+            "Push from upstream streaming thread instead of worker pool",
+            FALSE,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_DROPPED_FRAMES,
+        g_param_spec_uint64(
+            "dropped-frames", "Dropped Frames",
+            "Number of frames dropped on queue overflow or while waiting for key frame",
+            0, G_MAXUINT64, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_DROPPED_BUFFERS,
+        g_param_spec_uint64(
+            "dropped-buffers", "Dropped Buffers",
+            "Number of buffers dropped on queue overflow or while waiting for key frame",
+            0, G_MAXUINT64, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_TIME_TO_FIRST_FRAME,
+        g_param_spec_uint64(
+            "time-to-first-frame", "Time To First Frame",
+            "Time between pad request and first pushed buffer (in nanoseconds), 0 if nothing pushed yet",
+            0, G_MAXUINT64, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_PAUSED,
+        g_param_spec_boolean(
+            "paused", "Paused",
+            "Drop all buffers, on resume pad restarts from key frame",
+            FALSE,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_HOLD,
+        g_param_spec_boolean(
+            "hold", "Hold",
+            "Deliver events only till peer is ready to take buffers (pad is still counted as active), "
+            "on release pad starts from key frame",
+            FALSE,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_DEGRADATION,
+        g_param_spec_uint(
+            "degradation", "Degradation",
+            "FanOutPadDegradation: 0 - none, 1 - reduced queue, 2 - key frames only",
+            FAN_OUT_PAD_DEGRADATION_NONE, FAN_OUT_PAD_DEGRADATION_KEY_FRAMES_ONLY,
+            FAN_OUT_PAD_DEGRADATION_NONE,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_FILL_LEVEL,
+        g_param_spec_uint(
+            "fill-level", "Fill Level",
+            "Queued buffers in percents of queue limit",
+            0, G_MAXUINT, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_MAX_SIZE_BUFFERS,
+        g_param_spec_uint(
+            "max-size-buffers", "Max Size Buffers",
+            "Queue limit of this pad only (reset by element's \"max-size-buffers\")",
+            1, G_MAXUINT, DEFAULT_MAX_SIZE_BUFFERS,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_PACING_FACTOR,
+        g_param_spec_double(
+            "pacing-factor", "Pacing Factor",
+            "Buffers are spread at that multiple of measured bitrate (0 - no pacing)",
+            0, 100, 0,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_PACING_MAX_DELAY,
+        g_param_spec_uint64(
+            "pacing-max-delay", "Pacing Max Delay",
+            "Max time buffer can be held by pacer (in nanoseconds)",
+            0, G_MAXUINT64, DEFAULT_PACING_MAX_DELAY_MS * GST_MSECOND,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_PACED_BUFFERS,
+        g_param_spec_uint64(
+            "paced-buffers", "Paced Buffers",
+            "Number of buffers held by pacer",
+            0, G_MAXUINT64, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_PACING_DELAY,
+        g_param_spec_uint64(
+            "pacing-delay", "Pacing Delay",
+            "Total time buffers were held by pacer (in nanoseconds)",
+            0, G_MAXUINT64, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_MAX_PACING_DELAY,
+        g_param_spec_uint64(
+            "max-pacing-delay", "Max Pacing Delay",
+            "Longest time buffer was held by pacer (in nanoseconds)",
+            0, G_MAXUINT64, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_MAX_BURST,
+        g_param_spec_uint(
+            "max-burst", "Max Burst",
+            "Longest run of buffers pushed less than 1ms apart while pacing",
+            0, G_MAXUINT, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_GOP_REPLAYS,
+        g_param_spec_uint(
+            "gop-replays", "GOP Replays",
+            "Number of times pad (re)started from GOP cache",
+            0, G_MAXUINT, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PAD_PROP_SKIPPED_GOP_REPLAYS,
+        g_param_spec_uint(
+            "skipped-gop-replays", "Skipped GOP Replays",
+            "Number of times pad (re)started without GOP cache replay since current GOP could not be replayed",
+            0, G_MAXUINT, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+}
+
+static void fan_out_pad_init(FanOutPad* self)
+{
+    self->p = new FanOutPadPrivate;
+}
+
+static gboolean fan_out_pad_activate_mode(
+    GstPad* pad,
+    GstObject* /*parent*/,
+    GstPadMode mode,
+    gboolean active)
+{
+    if(mode != GST_PAD_MODE_PUSH)
+        return FALSE;
+
+    FanOutPadPrivate* p = _FAN_OUT_PAD(pad)->p;
+
+    std::lock_guard<std::mutex> lock(p->mutex);
+    p->flushing = !active;
+    if(!active)
+        p->clear();
+
+    return TRUE;
+}
+
+// schedules pad with items queued while it wasn't drained
+static void fan_out_pad_schedule(FanOutPad* pad)
+{
+    FanOutPadPrivate* p = pad->p;
+
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        if(p->linked && !p->items.empty() && !p->scheduled) {
+            p->scheduled = true;
+            schedule = true;
+        }
+    }
+
+    if(schedule)
+        g_thread_pool_push(WorkersPool(), gst_object_ref(pad), nullptr);
+}
+
+static GstPadLinkReturn fan_out_pad_link(
+    GstPad* pad,
+    GstObject* /*parent*/,
+    GstPad* /*peer*/)
+{
+    FanOutPad* self = _FAN_OUT_PAD(pad);
+
+    {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        self->p->linked = true;
+    }
+
+    fan_out_pad_schedule(self);
+
+    return GST_PAD_LINK_OK;
+}
+
+static void fan_out_pad_unlink(GstPad* pad, GstObject* /*parent*/)
+{
+    FanOutPadPrivate* p = _FAN_OUT_PAD(pad)->p;
+
+    std::lock_guard<std::mutex> lock(p->mutex);
+    p->linked = false;
+}
+
+static void fan_out_pad_flush(FanOutPad* pad)
+{
+    FanOutPadPrivate* p = pad->p;
+
+    std::lock_guard<std::mutex> lock(p->mutex);
+    p->clear();
+}
+
+// will be called from worker thread
+static void fan_out_pad_drain(FanOutPad* pad)
+{
+    FanOutPadPrivate* p = pad->p;
+
+    // deactivation of pad waits for stream lock, so pad is never pushed after release
+    GST_PAD_STREAM_LOCK(pad);
+
+    for(unsigned i = 0; i < MAX_ITEMS_PER_RUN; ++i) {
+        QueueItem item {};
+        guint32 replayRtpTimestamp = 0;
+        GstClockTime replayPts = GST_CLOCK_TIME_NONE;
+        gint64 pacingDeadline = 0;
+        GstBufferList* list = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(p->mutex);
+            const gint64 now = p->pacing() ? g_get_monotonic_time() : 0;
+            if(p->items.empty()) {
+                p->scheduled = false;
+            } else if(const gint64 wait = p->pacingWait(now)) {
+                // pad stays scheduled while pacer holds it
+                pacingDeadline = now + wait;
+            } else {
+                item = p->takeFront(now);
+                if(item.flags & ITEM_REPLAYED) {
+                    if((item.flags & ITEM_FRAME_START) && p->replayFramesLeft)
+                        --p->replayFramesLeft;
+                    replayRtpTimestamp = p->replayRtpTimestamp - p->replayFramesLeft;
+                    replayPts = p->replayPts;
+                } else if(GST_IS_BUFFER(item.object)) {
+                    // consecutive buffers go downstream as single list,
+                    // so webrtcbin takes its locks once per list instead of once per packet
+                    while(!p->items.empty() && (list ? gst_buffer_list_length(list) : 1) < MAX_ITEMS_PER_RUN) {
+                        const QueueItem& next = p->items.front();
+                        if(!GST_IS_BUFFER(next.object) || (next.flags & ITEM_REPLAYED) || p->pacingWait(now))
+                            break;
+
+                        if(!list) {
+                            list = gst_buffer_list_new();
+                            gst_buffer_list_add(list, GST_BUFFER_CAST(item.object));
+                            item.object = GST_MINI_OBJECT_CAST(list);
+                        }
+                        gst_buffer_list_add(list, GST_BUFFER_CAST(p->takeFront(now).object));
+                    }
+                }
+            }
+        }
+
+        if(pacingDeadline) {
+            GST_PAD_STREAM_UNLOCK(pad);
+            SchedulePacedPad(pad, pacingDeadline);
+            return;
+        }
+
+        if(!item.object) {
+            GST_PAD_STREAM_UNLOCK(pad);
+            gst_object_unref(pad);
+            return;
+        }
+
+        if(list)
+            PushedBytes += gst_buffer_list_calculate_size(list);
+        else if(GST_IS_BUFFER(item.object))
+            PushedBytes += gst_buffer_get_size(GST_BUFFER_CAST(item.object));
+
+        if(list) {
+            gst_pad_push_list(GST_PAD_CAST(pad), list);
+        } else if(item.flags & ITEM_REPLAYED) {
+            GstBuffer* buffer = gst_buffer_make_writable(GST_BUFFER_CAST(item.object));
+            GstRtStreaming::SetRtpTimestamp(buffer, replayRtpTimestamp);
+            GST_BUFFER_PTS(buffer) = replayPts;
+            GST_BUFFER_DTS(buffer) = GST_CLOCK_TIME_NONE;
+            gst_pad_push(GST_PAD_CAST(pad), buffer);
+        } else if(GST_IS_BUFFER(item.object)) {
+            gst_pad_push(GST_PAD_CAST(pad), GST_BUFFER_CAST(item.object));
+        } else if(item.flags & ITEM_STICKY_EVENTS_PROBE) {
+            const gboolean delivered =
+                gst_pad_push_event(GST_PAD_CAST(pad), GST_EVENT_CAST(item.object));
+
+            std::lock_guard<std::mutex> lock(p->mutex);
+            p->stickyEventsProbeQueued = false;
+            if(delivered)
+                p->stickyEventsDelivered = true;
+        } else {
+            gst_pad_push_event(GST_PAD_CAST(pad), GST_EVENT_CAST(item.object));
+        }
+    }
+
+    GST_PAD_STREAM_UNLOCK(pad);
+
+    // pad is still scheduled, so ownership of reference goes back to pool
+    g_thread_pool_push(WorkersPool(), pad, nullptr);
+}
+
+// will be called with FanOutPadPrivate::mutex locked
+// returns true if pad should be scheduled
+static bool fan_out_pad_enqueue_locked(
+    FanOutPad* pad,
+    GstMiniObject* object,
+    guint8 flags,
+    guint64 sequence,
+    gint64 now)
+{
+    FanOutPadPrivate* p = pad->p;
+
+    gint64 time = 0;
+
+    if(p->flushing) {
+        gst_mini_object_unref(object);
+        return false;
+    }
+
+    if(GST_IS_BUFFER(object)) {
+        if(p->paused || sequence <= p->resumeSequence) {
+            gst_mini_object_unref(object);
+            return false;
+        }
+
+        if(p->held) {
+            gst_mini_object_unref(object);
+
+            // caps etc. should reach peer while it negotiates, buffers would block worker
+            if(p->stickyEventsDelivered || p->stickyEventsProbeQueued)
+                return false;
+
+            object = NewStickyEventsProbe();
+            flags = ITEM_STICKY_EVENTS_PROBE;
+            p->stickyEventsProbeQueued = true;
+        } else {
+            if(p->degradation == FAN_OUT_PAD_DEGRADATION_KEY_FRAMES_ONLY &&
+                (flags & ITEM_FRAME_START) && !(flags & ITEM_KEY_FRAME))
+            {
+                p->waitKeyFrame = true;
+            }
+
+            if(p->waitKeyFrame && (flags & ITEM_FRAME_START) && (flags & ITEM_KEY_FRAME)) {
+                p->waitKeyFrame = false;
+                p->stickyEventsDelivered = true;
+            }
+
+            if(!p->waitKeyFrame && p->buffersCount >= p->effectiveMaxSizeBuffers()) {
+                // peer is behind: the rest of current frame can't be decoded,
+                // and every frame up to next key frame depends on it
+                p->trimIncompleteFrame();
+                p->waitKeyFrame = true;
+            }
+
+            if(p->pacing()) {
+                // dropped buffers are counted too, so pacing rate doesn't depend on peer's state
+                time = now ? now : g_get_monotonic_time();
+                p->updateByteRate(gst_buffer_get_size(GST_BUFFER_CAST(object)), time);
+            }
+
+            if(p->waitKeyFrame) {
+                ++p->droppedBuffers;
+                if(flags & ITEM_FRAME_END)
+                    ++p->droppedFrames;
+
+                time = 0;
+                gst_mini_object_unref(object);
+
+                // caps etc. should reach peer even before first key frame
+                if(p->stickyEventsDelivered || p->stickyEventsProbeQueued)
+                    return false;
+
+                object = NewStickyEventsProbe();
+                flags = ITEM_STICKY_EVENTS_PROBE;
+                p->stickyEventsProbeQueued = true;
+            } else {
+                ++p->buffersCount;
+            }
+        }
+    }
+
+    p->items.emplace_back(QueueItem { object, flags, time });
+
+    if(!p->scheduled && p->linked) {
+        p->scheduled = true;
+        return true;
+    }
+
+    return false;
+}
+
+// will be called from streaming thread
+static void fan_out_pad_enqueue(
+    FanOutPad* pad,
+    GstMiniObject* object,
+    guint8 flags,
+    guint64 sequence)
+{
+    bool schedule;
+    {
+        std::lock_guard<std::mutex> lock(pad->p->mutex);
+        schedule = fan_out_pad_enqueue_locked(pad, object, flags, sequence, 0);
+    }
+
+    if(schedule)
+        g_thread_pool_push(WorkersPool(), gst_object_ref(pad), nullptr);
+}
+
+// will be called from streaming thread
+// whole list is queued under single lock, buffers get consecutive sequence numbers
+static void fan_out_pad_enqueue_list(
+    FanOutPad* pad,
+    GstBufferList* list,
+    const guint8* flags,
+    guint64 firstSequence)
+{
+    FanOutPadPrivate* p = pad->p;
+
+    const guint length = gst_buffer_list_length(list);
+
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+
+        const gint64 now = p->pacing() ? g_get_monotonic_time() : 0;
+        for(guint i = 0; i < length; ++i) {
+            GstMiniObject* buffer = GST_MINI_OBJECT_CAST(gst_buffer_ref(gst_buffer_list_get(list, i)));
+            if(fan_out_pad_enqueue_locked(pad, buffer, flags[i], firstSequence + i, now))
+                schedule = true;
+        }
+    }
+
+    if(schedule)
+        g_thread_pool_push(WorkersPool(), gst_object_ref(pad), nullptr);
+}
+
+// will be called with FanOutPrivate::mutex locked
+// gopCacheOverflowed means current GOP didn't fit into cache
+static bool fan_out_pad_replay(
+    FanOutPad* pad,
+    const std::vector<QueueItem>& gopCache,
+    bool gopCacheOverflowed)
+{
+    using namespace GstRtStreaming;
+
+    FanOutPadPrivate* p = pad->p;
+
+    if(gopCache.empty()) {
+        if(gopCacheOverflowed) {
+            std::lock_guard<std::mutex> lock(p->mutex);
+            if(!p->blocked())
+                ++p->skippedGopReplays;
+        }
+        return false;
+    }
+
+    GstBuffer* lastBuffer = GST_BUFFER_CAST(gopCache.back().object);
+    RtpPacketInfo lastPacketInfo;
+    const bool parsed = ParseRtpPacket(RtpCodec::Unknown, lastBuffer, &lastPacketInfo);
+
+    guint framesCount = 0;
+    for(const QueueItem& item: gopCache) {
+        if(item.flags & ITEM_FRAME_START)
+            ++framesCount;
+    }
+
+    std::lock_guard<std::mutex> lock(p->mutex);
+
+    if(p->blocked())
+        return false;
+
+    if(!parsed) {
+        ++p->skippedGopReplays;
+        return false;
+    }
+
+    // cache size is bounded by "gop-cache-max-bytes" only,
+    // and replayed buffers are not counted in queue limit,
+    // otherwise live buffers queued while replay is drained would trigger overflow
+    for(const QueueItem& item: gopCache) {
+        p->items.emplace_back(
+            QueueItem {
+                gst_mini_object_ref(item.object),
+                guint8(item.flags | ITEM_REPLAYED) });
+    }
+    ++p->gopReplays;
+
+    p->replayFramesLeft = framesCount;
+    p->replayRtpTimestamp = lastPacketInfo.timestamp;
+    p->replayPts = GST_BUFFER_PTS(lastBuffer);
+
+    // the cache starts from key frame
+    p->waitKeyFrame = false;
+    p->stickyEventsDelivered = true;
+
+    return true;
+}
+
+// written from streaming thread only, read from any thread without locking
+struct StreamStats
+{
+    struct Bucket {
+        std::atomic<gint64> second { -1 };
+        std::atomic<guint64> bytes { 0 };
+        std::atomic<guint64> packets { 0 };
+        std::atomic<guint64> frames { 0 };
+    };
+
+    void update(gsize size, guint8 flags, bool framesKnown, const GstRtStreaming::RtpPacketInfo* packetInfo) {
+        const gint64 now = g_get_monotonic_time();
+
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        packets.fetch_add(1, std::memory_order_relaxed);
+        lastBufferTime.store(now, std::memory_order_relaxed);
+
+        const bool frameEnd = framesKnown && (flags & ITEM_FRAME_END);
+        if(frameEnd)
+            frames.fetch_add(1, std::memory_order_relaxed);
+
+        if(framesKnown && (flags & ITEM_FRAME_START)) {
+            ++framesSinceKeyFrame;
+            if(flags & ITEM_KEY_FRAME)
+                onKeyFrame();
+        }
+
+        // current bucket is recycled once per second,
+        // readers use completed buckets only
+        const gint64 second = now / G_USEC_PER_SEC;
+        Bucket& bucket = buckets[second % G_N_ELEMENTS(buckets)];
+        if(bucket.second.load(std::memory_order_relaxed) != second) {
+            bucket.bytes.store(0, std::memory_order_relaxed);
+            bucket.packets.store(0, std::memory_order_relaxed);
+            bucket.frames.store(0, std::memory_order_relaxed);
+            bucket.second.store(second, std::memory_order_release);
+        }
+        bucket.bytes.fetch_add(size, std::memory_order_relaxed);
+        bucket.packets.fetch_add(1, std::memory_order_relaxed);
+        if(frameEnd)
+            bucket.frames.fetch_add(1, std::memory_order_relaxed);
+
+        // RFC 3550 interarrival jitter
+        const guint rate = clockRate.load(std::memory_order_relaxed);
+        if(packetInfo && rate) {
+            if(prevArrival) {
+                const gint32 rtpDelta = gint32(packetInfo->timestamp - prevRtpTimestamp);
+                const double transitDelta =
+                    double(now - prevArrival) - double(rtpDelta) * G_USEC_PER_SEC / rate;
+                jitterValue += (std::abs(transitDelta) - jitterValue) / 16;
+                jitter.store(guint64(jitterValue), std::memory_order_relaxed);
+            }
+            prevArrival = now;
+            prevRtpTimestamp = packetInfo->timestamp;
+        }
+    }
+
+    // current frame is key one, could be known only after its first packet
+    void onKeyFrame() {
+        keyFrames.fetch_add(1, std::memory_order_relaxed);
+        if(keyFrameSeen)
+            gopLength.store(framesSinceKeyFrame - 1, std::memory_order_relaxed);
+        keyFrameSeen = true;
+        framesSinceKeyFrame = 1;
+    }
+
+    // stream discontinuity
+    void reset() {
+        keyFrameSeen = false;
+        framesSinceKeyFrame = 0;
+        prevArrival = 0;
+    }
+
+    GstStructure* snapshot() const {
+        const gint64 currentSecond = g_get_monotonic_time() / G_USEC_PER_SEC;
+
+        guint64 windowBytes = 0, windowPackets = 0, windowFrames = 0;
+        for(const Bucket& bucket: buckets) {
+            const gint64 second = bucket.second.load(std::memory_order_acquire);
+            if(second < currentSecond && second >= currentSecond - STATS_WINDOW_SECONDS) {
+                windowBytes += bucket.bytes.load(std::memory_order_relaxed);
+                windowPackets += bucket.packets.load(std::memory_order_relaxed);
+                windowFrames += bucket.frames.load(std::memory_order_relaxed);
+            }
+        }
+
+        return gst_structure_new(
+            "application/x-rtfanout-stats",
+            "bytes", G_TYPE_UINT64, bytes.load(std::memory_order_relaxed),
+            "packets", G_TYPE_UINT64, packets.load(std::memory_order_relaxed),
+            "frames", G_TYPE_UINT64, frames.load(std::memory_order_relaxed),
+            "key-frames", G_TYPE_UINT64, keyFrames.load(std::memory_order_relaxed),
+            "gop-length", G_TYPE_UINT, gopLength.load(std::memory_order_relaxed),
+            "jitter", G_TYPE_UINT64, jitter.load(std::memory_order_relaxed),
+            "last-buffer-time", G_TYPE_INT64, lastBufferTime.load(std::memory_order_relaxed),
+            "bitrate", G_TYPE_UINT64, windowBytes * 8 / STATS_WINDOW_SECONDS,
+            "packet-rate", G_TYPE_UINT64, windowPackets / STATS_WINDOW_SECONDS,
+            "frame-rate", G_TYPE_UINT64, windowFrames / STATS_WINDOW_SECONDS,
+            nullptr);
+    }
+
+    std::atomic<guint> clockRate { 0 };
+
+    std::atomic<guint64> bytes { 0 };
+    std::atomic<guint64> packets { 0 };
+    std::atomic<guint64> frames { 0 };
+    std::atomic<guint64> keyFrames { 0 };
+    std::atomic<guint> gopLength { 0 }; // frames between last two key frames
+    std::atomic<guint64> jitter { 0 }; // microseconds
+    std::atomic<gint64> lastBufferTime { 0 }; // g_get_monotonic_time()
+
+    // one extra bucket is being filled right now
+    Bucket buckets[STATS_WINDOW_SECONDS + 1];
+
+    // accessed from streaming thread only
+    bool keyFrameSeen = false;
+    guint framesSinceKeyFrame = 0;
+    gint64 prevArrival = 0;
+    guint32 prevRtpTimestamp = 0;
+    double jitterValue = 0;
+};
+
+struct FanOutPrivate
+{
+    ~FanOutPrivate() {
+        for(GstEvent* event: stickyEvents)
+            gst_event_unref(event);
+        clearGopCache();
+        if(frameList)
+            gst_buffer_list_unref(frameList);
+    }
+
+    void clearGopCache() {
+        for(QueueItem& item: gopCache)
+            gst_mini_object_unref(item.object);
+        gopCache.clear();
+        gopCacheBytes = 0;
+        gopCacheStarted = false;
+        gopCacheOverflowed = false;
+    }
+
+    void updateGopCache(GstBuffer* buffer, guint8 flags, guint64 sequence) {
+        if(flags & ITEM_KEY_FRAME) {
+            clearGopCache();
+            gopCacheStarted = true;
+            gopCacheSequence = sequence;
+        }
+
+        if(!gopCacheStarted)
+            return;
+
+        const gsize size = gst_buffer_get_size(buffer);
+        if(gopCacheBytes + size > gopCacheMaxBytes) {
+            // GOP doesn't fit into budget, so nothing to replay till next key frame
+            clearGopCache();
+            gopCacheOverflowed = true;
+            return;
+        }
+
+        gopCache.emplace_back(QueueItem { GST_MINI_OBJECT_CAST(gst_buffer_ref(buffer)), flags });
+        gopCacheBytes += size;
+    }
+
+    std::mutex mutex;
+    PadListPtr padList = std::make_shared<PadList>();
+    std::vector<GstEvent*> stickyEvents;
+    guint nextPadIndex = 0;
+    guint maxSizeBuffers = DEFAULT_MAX_SIZE_BUFFERS;
+
+    // buffers since last key frame, replayed to every new pad
+    guint64 gopCacheMaxBytes = 0;
+    std::vector<QueueItem> gopCache;
+    guint64 gopCacheBytes = 0;
+    bool gopCacheStarted = false;
+    bool gopCacheOverflowed = false;
+    // sequence of cached key frame
+    guint64 gopCacheSequence = 0;
+
+    // incremented for every dispatched buffer
+    guint64 bufferSequence = 0;
+
+    std::atomic<GstRtStreaming::RtpCodec> codec { GstRtStreaming::RtpCodec::Unknown };
+    std::atomic<bool> frameLists { false };
+    std::atomic<bool> drop { false };
+    // accessed from streaming thread only
+    bool frameCompleted = true;
+    // current frame started with SEI, AUD etc. and no slice is seen yet
+    bool frameKeyPending = false;
+    // packets of current frame, dispatched as single list once frame is complete
+    // (or once it's known if it is key frame)
+    GstBufferList* frameList = nullptr;
+    std::vector<guint8> frameFlags;
+    std::vector<guint8> listFlags;
+
+    StreamStats stats;
+};
+
+struct _FanOut
+{
+    GstElement parent_instance;
+
+    GstPad* sinkPad;
+
+    FanOutPrivate* p;
+};
+
+G_DEFINE_TYPE(FanOut, fan_out, GST_TYPE_ELEMENT)
+
+// will be called from streaming thread
+// packet is classified once and the result is shared by all pads.
+// keyFrameResolved is set if packet revealed that current frame, started earlier, is key one
+static guint8 fan_out_classify(FanOutPrivate* p, GstBuffer* buffer, bool* keyFrameResolved)
+{
+    using namespace GstRtStreaming;
+
+    const RtpCodec codec = p->codec;
+    guint8 flags = 0;
+    RtpPacketInfo packetInfo;
+    // RTP header of other codecs is parsed for jitter only
+    const bool parsed =
+        (codec != RtpCodec::Unknown || p->stats.clockRate) &&
+        ParseRtpPacket(codec, buffer, &packetInfo);
+    if(parsed && codec != RtpCodec::Unknown) {
+        if(p->frameCompleted) {
+            flags |= ITEM_FRAME_START;
+            if(packetInfo.keyFrame)
+                flags |= ITEM_KEY_FRAME;
+            // access unit can start with SEI, AUD etc. before SPS/IDR
+            p->frameKeyPending = packetInfo.prefixOnly;
+        } else if(p->frameKeyPending && !packetInfo.prefixOnly) {
+            p->frameKeyPending = false;
+            *keyFrameResolved = packetInfo.keyFrame;
+        }
+        if(packetInfo.marker) {
+            flags |= ITEM_FRAME_END;
+            p->frameKeyPending = false;
+        }
+
+        p->frameCompleted = packetInfo.marker;
+    } else {
+        // frame boundaries are unknown: every buffer is treated as self contained
+        flags = ITEM_FRAME_START | ITEM_FRAME_END | ITEM_KEY_FRAME;
+    }
+
+    p->stats.update(
+        gst_buffer_get_size(buffer),
+        flags,
+        codec != RtpCodec::Unknown,
+        parsed ? &packetInfo : nullptr);
+    if(*keyFrameResolved)
+        p->stats.onKeyFrame();
+
+    return flags;
+}
+
+// will be called from streaming thread
+static GstFlowReturn fan_out_dispatch_buffer(FanOut* self, GstBuffer* buffer, guint8 flags)
+{
+    FanOutPrivate* p = self->p;
+
+    GstFlowReturn flowReturn = GST_FLOW_OK;
+
+    PadListPtr padList;
+    guint64 sequence;
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+
+        // cache is updated atomically with pads list,
+        // so new pad gets every buffer exactly once
+        sequence = ++p->bufferSequence;
+        if(p->gopCacheMaxBytes && p->codec != GstRtStreaming::RtpCodec::Unknown)
+            p->updateGopCache(buffer, flags, sequence);
+
+        padList = p->padList;
+    }
+
+    // direct pads (sync fakesink etc.) are still fed, since they pace non live sources
+    const bool drop = p->drop;
+    for(FanOutPad* pad: padList->pads) {
+        if(pad->p->direct) {
+            if(GST_FLOW_FLUSHING == gst_pad_push(GST_PAD_CAST(pad), gst_buffer_ref(buffer)))
+                flowReturn = GST_FLOW_FLUSHING;
+        } else if(!drop) {
+            fan_out_pad_enqueue(pad, GST_MINI_OBJECT_CAST(gst_buffer_ref(buffer)), flags, sequence);
+        }
+    }
+
+    gst_buffer_unref(buffer);
+
+    return flowReturn;
+}
+
+// will be called from streaming thread
+// pads list is taken and every pad is locked once per list, not once per buffer
+static GstFlowReturn fan_out_dispatch_list(FanOut* self, GstBufferList* list, const guint8* flags)
+{
+    FanOutPrivate* p = self->p;
+
+    const guint length = gst_buffer_list_length(list);
+
+    GstFlowReturn flowReturn = GST_FLOW_OK;
+
+    PadListPtr padList;
+    guint64 firstSequence;
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+
+        firstSequence = p->bufferSequence + 1;
+        p->bufferSequence += length;
+        if(p->gopCacheMaxBytes && p->codec != GstRtStreaming::RtpCodec::Unknown) {
+            for(guint i = 0; i < length; ++i)
+                p->updateGopCache(gst_buffer_list_get(list, i), flags[i], firstSequence + i);
+        }
+
+        padList = p->padList;
+    }
+
+    const bool drop = p->drop;
+    for(FanOutPad* pad: padList->pads) {
+        if(pad->p->direct) {
+            if(GST_FLOW_FLUSHING == gst_pad_push_list(GST_PAD_CAST(pad), gst_buffer_list_ref(list)))
+                flowReturn = GST_FLOW_FLUSHING;
+        } else if(!drop) {
+            fan_out_pad_enqueue_list(pad, list, flags, firstSequence);
+        }
+    }
+
+    gst_buffer_list_unref(list);
+
+    return flowReturn;
+}
+
+// will be called from streaming thread
+static GstFlowReturn fan_out_flush_frame(FanOut* self)
+{
+    FanOutPrivate* p = self->p;
+
+    if(!p->frameList)
+        return GST_FLOW_OK;
+
+    GstBufferList* list = p->frameList;
+    p->frameList = nullptr;
+    // frame without any slice so far is dispatched as non key one
+    p->frameKeyPending = false;
+
+    const GstFlowReturn flowReturn = fan_out_dispatch_list(self, list, p->frameFlags.data());
+    p->frameFlags.clear();
+
+    return flowReturn;
+}
+
+// will be called from streaming thread
+static void fan_out_drop_frame(FanOut* self)
+{
+    FanOutPrivate* p = self->p;
+
+    if(p->frameList) {
+        gst_buffer_list_unref(p->frameList);
+        p->frameList = nullptr;
+    }
+    p->frameFlags.clear();
+    p->frameKeyPending = false;
+}
+
+// will be called from streaming thread
+// takes classified buffer, holds it while frame is accumulated
+static GstFlowReturn fan_out_push(
+    FanOut* self,
+    GstBuffer* buffer,
+    guint8 flags,
+    bool keyFrameResolved)
+{
+    FanOutPrivate* p = self->p;
+
+    GstFlowReturn flowReturn = GST_FLOW_OK;
+
+    // anything accumulated belongs to previous (incomplete) frame
+    if(flags & ITEM_FRAME_START)
+        flowReturn = fan_out_flush_frame(self);
+
+    // frame is marked as key by its first packet, so packets before first slice are held.
+    // Payloader pushes whole frame at once, so holding it till marker adds no latency either
+    const bool frameLists =
+        p->frameLists && p->codec != GstRtStreaming::RtpCodec::Unknown;
+    if(!p->frameList && !p->frameKeyPending && !frameLists) {
+        const GstFlowReturn bufferFlowReturn = fan_out_dispatch_buffer(self, buffer, flags);
+        return flowReturn != GST_FLOW_OK ? flowReturn : bufferFlowReturn;
+    }
+
+    if(keyFrameResolved && !p->frameFlags.empty())
+        p->frameFlags.front() |= ITEM_KEY_FRAME;
+
+    if(!p->frameList)
+        p->frameList = gst_buffer_list_new();
+    gst_buffer_list_add(p->frameList, buffer);
+    p->frameFlags.push_back(flags);
+
+    if((flags & ITEM_FRAME_END) ||
+        p->frameFlags.size() >= MAX_FRAME_LIST_SIZE ||
+        (!p->frameKeyPending && !frameLists))
+    {
+        const GstFlowReturn frameFlowReturn = fan_out_flush_frame(self);
+        return flowReturn != GST_FLOW_OK ? flowReturn : frameFlowReturn;
+    }
+
+    return flowReturn;
+}
+
+// will be called from streaming thread
+static GstFlowReturn fan_out_chain(GstPad*, GstObject* parent, GstBuffer* buffer)
+{
+    FanOut* self = _FAN_OUT(parent);
+
+    bool keyFrameResolved = false;
+    const guint8 flags = fan_out_classify(self->p, buffer, &keyFrameResolved);
+
+    return fan_out_push(self, buffer, flags, keyFrameResolved);
+}
+
+// will be called from streaming thread
+static GstFlowReturn fan_out_chain_list(GstPad*, GstObject* parent, GstBufferList* list)
+{
+    FanOut* self = _FAN_OUT(parent);
+    FanOutPrivate* p = self->p;
+
+    const guint length = gst_buffer_list_length(list);
+    if(!length) {
+        gst_buffer_list_unref(list);
+        return GST_FLOW_OK;
+    }
+
+    p->listFlags.resize(length);
+
+    // list is dispatched as is unless some of its frames has to be held (see fan_out_push)
+    guint classified = 0;
+    if(!p->frameList) {
+        while(classified < length && !p->frameKeyPending) {
+            bool keyFrameResolved = false;
+            p->listFlags[classified] =
+                fan_out_classify(p, gst_buffer_list_get(list, classified), &keyFrameResolved);
+            ++classified;
+        }
+
+        if(!p->frameKeyPending)
+            return fan_out_dispatch_list(self, list, p->listFlags.data());
+    }
+
+    GstFlowReturn flowReturn = GST_FLOW_OK;
+
+    guint i = 0;
+    if(classified) {
+        // the last classified buffer starts frame to hold
+        const guint headLength = classified - 1;
+        if(headLength) {
+            GstBufferList* headList = gst_buffer_list_new_sized(headLength);
+            for(guint j = 0; j < headLength; ++j)
+                gst_buffer_list_add(headList, gst_buffer_ref(gst_buffer_list_get(list, j)));
+            flowReturn = fan_out_dispatch_list(self, headList, p->listFlags.data());
+        }
+
+        const GstFlowReturn pushFlowReturn =
+            fan_out_push(
+                self,
+                gst_buffer_ref(gst_buffer_list_get(list, headLength)),
+                p->listFlags[headLength],
+                false);
+        if(flowReturn == GST_FLOW_OK)
+            flowReturn = pushFlowReturn;
+
+        i = classified;
+    }
+
+    for(; i < length; ++i) {
+        GstBuffer* buffer = gst_buffer_list_get(list, i);
+
+        bool keyFrameResolved = false;
+        const guint8 flags = fan_out_classify(p, buffer, &keyFrameResolved);
+
+        const GstFlowReturn pushFlowReturn =
+            fan_out_push(self, gst_buffer_ref(buffer), flags, keyFrameResolved);
+        if(flowReturn == GST_FLOW_OK)
+            flowReturn = pushFlowReturn;
+    }
+
+    gst_buffer_list_unref(list);
+
+    return flowReturn;
+}
+
+static gboolean fan_out_sink_event(GstPad*, GstObject* parent, GstEvent* event)
+{
+    FanOut* self = _FAN_OUT(parent);
+    FanOutPrivate* p = self->p;
+
+    // serialized events come from streaming thread, after accumulated packets
+    if(GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
+        fan_out_drop_frame(self);
+    else if(GST_EVENT_IS_SERIALIZED(event))
+        fan_out_flush_frame(self);
+
+    switch(GST_EVENT_TYPE(event)) {
+    case GST_EVENT_CAPS: {
+        GstCaps* caps;
+        gst_event_parse_caps(event, &caps);
+        const GstRtStreaming::RtpCodec codec = GstRtStreaming::ParseRtpCodec(caps);
+
+        gint clockRate = 0;
+        if(!gst_caps_is_empty(caps) && !gst_caps_is_any(caps))
+            gst_structure_get_int(gst_caps_get_structure(caps, 0), "clock-rate", &clockRate);
+        p->stats.clockRate = clockRate > 0 ? clockRate : 0;
+        p->stats.reset();
+
+        if(p->codec.exchange(codec) != codec) {
+            std::lock_guard<std::mutex> lock(p->mutex);
+            p->clearGopCache();
+        }
+        break;
+    }
+    case GST_EVENT_FLUSH_STOP:
+        p->frameCompleted = true;
+        p->stats.reset();
+        break;
+    default:
+        break;
+    }
+
+    PadListPtr padList;
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+
+        // own copy of sticky events is updated atomically with pads list,
+        // so new pad can't miss event which is being dispatched right now
+        if(GST_EVENT_IS_STICKY(event)) {
+            StoreStickyEvent(&p->stickyEvents, event);
+        } else if(GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP) {
+            RemoveStickyEvent(&p->stickyEvents, GST_EVENT_EOS);
+            RemoveStickyEvent(&p->stickyEvents, GST_EVENT_SEGMENT);
+            p->clearGopCache();
+        }
+
+        padList = p->padList;
+    }
+
+    for(FanOutPad* pad: padList->pads) {
+        if(GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_START)
+            fan_out_pad_flush(pad);
+
+        if(!GST_EVENT_IS_SERIALIZED(event) || pad->p->direct)
+            gst_pad_push_event(GST_PAD_CAST(pad), gst_event_ref(event));
+        else
+            fan_out_pad_enqueue(pad, GST_MINI_OBJECT_CAST(gst_event_ref(event)), 0, 0);
+    }
+
+    gst_event_unref(event);
+
+    return TRUE;
+}
+
+// flag is either "paused" or "held", buffers are dropped while any of them is set
+static void fan_out_pad_set_blocked(
+    FanOutPad* pad,
+    bool FanOutPadPrivate::* flag,
+    gboolean blocked)
+{
+    FanOutPadPrivate* p = pad->p;
+
+    GstElementPtr elementPtr(gst_pad_get_parent_element(GST_PAD_CAST(pad)));
+    if(!elementPtr) {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        p->*flag = blocked != FALSE;
+        return;
+    }
+
+    FanOut* self = _FAN_OUT(elementPtr.get());
+
+    bool resume = false;
+    bool replayed = false;
+    {
+        // pad's state is changed atomically with buffers dispatch and GOP cache
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+
+        guint64 blockSequence;
+        {
+            std::lock_guard<std::mutex> padLock(p->mutex);
+            if(p->*flag == (blocked != FALSE))
+                return;
+
+            if(blocked) {
+                if(!p->blocked()) {
+                    p->dropBuffers();
+                    p->blockSequence = p->firstBufferTime ? self->p->bufferSequence : 0;
+                }
+                // dropped buffers could be GOP replay queued on request
+                if(!p->firstBufferTime)
+                    p->stickyEventsDelivered = false;
+            } else if(!p->paused || !p->held) {
+                // otherwise the other flag still blocks pad
+                p->waitKeyFrame = true;
+                p->resumeSequence = self->p->bufferSequence;
+                resume = true;
+            }
+            p->*flag = blocked != FALSE;
+
+            blockSequence = p->blockSequence;
+        }
+
+        // peer paused within cached GOP has received (part of) it already,
+        // and replayed packets would be dropped by peer as duplicates
+        if(resume && self->p->gopCacheSequence > blockSequence)
+            replayed = fan_out_pad_replay(pad, self->p->gopCache, self->p->gopCacheOverflowed);
+    }
+
+    if(resume) {
+        if(replayed) {
+            fan_out_pad_schedule(pad);
+        } else {
+            // the same event is sent by video encoders and rtpsession understands it as PLI
+            gst_pad_push_event(
+                self->sinkPad,
+                gst_event_new_custom(
+                    GST_EVENT_CUSTOM_UPSTREAM,
+                    gst_structure_new(
+                        "GstForceKeyUnit",
+                        "all-headers", G_TYPE_BOOLEAN, TRUE,
+                        nullptr)));
+        }
+    }
+
+    if(flag == &FanOutPadPrivate::paused)
+        g_object_notify(G_OBJECT(self), "num-active-src-pads");
+}
+
+static GstPad* fan_out_request_new_pad(
+    GstElement* element,
+    GstPadTemplate* padTemplate,
+    const gchar* /*name*/,
+    const GstCaps*)
+{
+    FanOut* self = _FAN_OUT(element);
+    FanOutPrivate* p = self->p;
+
+    guint padIndex;
+    guint maxSizeBuffers;
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        padIndex = p->nextPadIndex++;
+        maxSizeBuffers = p->maxSizeBuffers;
+    }
+
+    GCharPtr padNamePtr(g_strdup_printf("src_%u", padIndex));
+    FanOutPad* pad = _FAN_OUT_PAD(
+        g_object_new(
+            FAN_OUT_PAD_TYPE,
+            "name", padNamePtr.get(),
+            "direction", GST_PAD_SRC,
+            "template", padTemplate,
+            nullptr));
+    GstPad* srcPad = GST_PAD_CAST(pad);
+
+    pad->p->maxSizeBuffers = maxSizeBuffers;
+
+    pad->p->requestTime = g_get_monotonic_time();
+
+    GST_PAD_SET_PROXY_CAPS(srcPad);
+    gst_pad_set_activatemode_function(srcPad, fan_out_pad_activate_mode);
+    gst_pad_set_link_function(srcPad, fan_out_pad_link);
+    gst_pad_set_unlink_function(srcPad, fan_out_pad_unlink);
+
+    if(GST_PAD_IS_ACTIVE(self->sinkPad))
+        gst_pad_set_active(srcPad, TRUE);
+
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+
+        for(GstEvent* event: p->stickyEvents)
+            gst_pad_store_sticky_event(srcPad, event);
+
+        fan_out_pad_replay(pad, p->gopCache, p->gopCacheOverflowed);
+
+        std::shared_ptr<PadList> padList = std::make_shared<PadList>();
+        padList->pads.reserve(p->padList->pads.size() + 1);
+        for(FanOutPad* existingPad: p->padList->pads)
+            padList->pads.push_back(_FAN_OUT_PAD(gst_object_ref(existingPad)));
+        padList->pads.push_back(_FAN_OUT_PAD(gst_object_ref(pad)));
+
+        p->padList = std::move(padList);
+    }
+
+    gst_element_add_pad(element, srcPad);
+
+    return srcPad;
+}
+
+static void fan_out_release_pad(GstElement* element, GstPad* srcPad)
+{
+    FanOut* self = _FAN_OUT(element);
+    FanOutPrivate* p = self->p;
+
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+
+        std::shared_ptr<PadList> padList = std::make_shared<PadList>();
+        padList->pads.reserve(p->padList->pads.size());
+        for(FanOutPad* pad: p->padList->pads) {
+            if(GST_PAD_CAST(pad) != srcPad)
+                padList->pads.push_back(_FAN_OUT_PAD(gst_object_ref(pad)));
+        }
+
+        p->padList = std::move(padList);
+    }
+
+    // drops queued data and waits for worker to finish with pad
+    gst_pad_set_active(srcPad, FALSE);
+
+    gst_element_remove_pad(element, srcPad);
+}
+
+static GstStateChangeReturn fan_out_change_state(
+    GstElement* element,
+    GstStateChange transition)
+{
+    FanOut* self = _FAN_OUT(element);
+
+    const GstStateChangeReturn ret =
+        GST_ELEMENT_CLASS(fan_out_parent_class)->change_state(element, transition);
+
+    if(transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+        FanOutPrivate* p = self->p;
+
+        std::lock_guard<std::mutex> lock(p->mutex);
+        for(GstEvent* event: p->stickyEvents)
+            gst_event_unref(event);
+        p->stickyEvents.clear();
+        p->clearGopCache();
+        // streaming thread is already stopped
+        fan_out_drop_frame(self);
+        p->frameCompleted = true;
+    }
+
+    return ret;
+}
+
+static void fan_out_set_property(
+    GObject* object,
+    guint propId,
+    const GValue* value,
+    GParamSpec* pspec)
+{
+    FanOut* self = _FAN_OUT(object);
+    FanOutPrivate* p = self->p;
+
+    switch(propId) {
+    case PROP_MAX_SIZE_BUFFERS: {
+        const guint maxSizeBuffers = g_value_get_uint(value);
+
+        std::lock_guard<std::mutex> lock(p->mutex);
+        p->maxSizeBuffers = maxSizeBuffers;
+        for(FanOutPad* pad: p->padList->pads) {
+            std::lock_guard<std::mutex> padLock(pad->p->mutex);
+            pad->p->maxSizeBuffers = maxSizeBuffers;
+        }
+        break;
+    }
+    case PROP_GOP_CACHE_MAX_BYTES: {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        p->gopCacheMaxBytes = g_value_get_uint64(value);
+        if(p->gopCacheBytes > p->gopCacheMaxBytes)
+            p->clearGopCache();
+        break;
+    }
+    case PROP_FRAME_LISTS:
+        p->frameLists = g_value_get_boolean(value);
+        break;
+    case PROP_DROP:
+        p->drop = g_value_get_boolean(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, propId, pspec);
+        break;
+    }
+}
+
+static void fan_out_get_property(
+    GObject* object,
+    guint propId,
+    GValue* value,
+    GParamSpec* pspec)
+{
+    FanOut* self = _FAN_OUT(object);
+    FanOutPrivate* p = self->p;
+
+    switch(propId) {
+    case PROP_NUM_SRC_PADS:
+        GST_OBJECT_LOCK(self);
+        g_value_set_int(value, GST_ELEMENT_CAST(self)->numsrcpads);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case PROP_NUM_ACTIVE_SRC_PADS: {
+        gint activePads = 0;
+        GST_OBJECT_LOCK(self);
+        for(GList* item = GST_ELEMENT_CAST(self)->srcpads; item; item = item->next) {
+            FanOutPadPrivate* padPrivate = _FAN_OUT_PAD(item->data)->p;
+            std::lock_guard<std::mutex> padLock(padPrivate->mutex);
+            if(!padPrivate->paused)
+                ++activePads;
+        }
+        GST_OBJECT_UNLOCK(self);
+        g_value_set_int(value, activePads);
+        break;
+    }
+    case PROP_MAX_SIZE_BUFFERS: {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        g_value_set_uint(value, p->maxSizeBuffers);
+        break;
+    }
+    case PROP_GOP_CACHE_MAX_BYTES: {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        g_value_set_uint64(value, p->gopCacheMaxBytes);
+        break;
+    }
+    case PROP_FRAME_LISTS:
+        g_value_set_boolean(value, p->frameLists);
+        break;
+    case PROP_DROP:
+        g_value_set_boolean(value, p->drop);
+        break;
+    case PROP_STATS:
+        g_value_take_boxed(value, p->stats.snapshot());
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, propId, pspec);
+        break;
+    }
+}
+
+static void fan_out_dispose(GObject* object)
+{
+    FanOut* self = _FAN_OUT(object);
+
+    {
+        std::lock_guard<std::mutex> lock(self->p->mutex);
+        self->p->padList = std::make_shared<PadList>();
+    }
+
+    G_OBJECT_CLASS(fan_out_parent_class)->dispose(object);
+}
+
+static void fan_out_finalize(GObject* object)
+{
+    FanOut* self = _FAN_OUT(object);
+
+    delete self->p;
+    self->p = nullptr;
+
+    G_OBJECT_CLASS(fan_out_parent_class)->finalize(object);
+}
+
+static void fan_out_class_init(FanOutClass* klass)
+{
+    GObjectClass* objectClass = G_OBJECT_CLASS(klass);
+    GstElementClass* elementClass = GST_ELEMENT_CLASS(klass);
+
+    objectClass->set_property = fan_out_set_property;
+    objectClass->get_property = fan_out_get_property;
+    objectClass->dispose = fan_out_dispose;
+    objectClass->finalize = fan_out_finalize;
+
+    g_object_class_install_property(
+        objectClass,
+        PROP_NUM_SRC_PADS,
+        g_param_spec_int(
+            "num-src-pads", "Num Src Pads",
+            "The number of source pads",
+            0, G_MAXINT, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PROP_NUM_ACTIVE_SRC_PADS,
+        g_param_spec_int(
+            "num-active-src-pads", "Num Active Src Pads",
+            "The number of source pads which are not paused",
+            0, G_MAXINT, 0,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PROP_MAX_SIZE_BUFFERS,
+        g_param_spec_uint(
+            "max-size-buffers", "Max Size Buffers",
+            "Max number of buffers queued per source pad, on overflow pad skips to next key frame",
+            1, G_MAXUINT, DEFAULT_MAX_SIZE_BUFFERS,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PROP_GOP_CACHE_MAX_BYTES,
+        g_param_spec_uint64(
+            "gop-cache-max-bytes", "GOP Cache Max Bytes",
+            "Memory budget for buffers since last key frame replayed to new source pads (0 = disabled)",
+            0, G_MAXUINT64, 0,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PROP_STATS,
+        g_param_spec_boxed(
+            "stats", "Stats",
+            "Incoming stream statistics (rates are averaged over last 5 seconds, jitter is in microseconds)",
+            GST_TYPE_STRUCTURE,
+            GParamFlags(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PROP_FRAME_LISTS,
+        g_param_spec_boolean(
+            "frame-lists", "Frame Lists",
+            "Accumulate packets pushed one by one till the end of frame and send them as single buffer list",
+            FALSE,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        objectClass,
+        PROP_DROP,
+        g_param_spec_boolean(
+            "drop", "Drop",
+            "Drop incoming buffers instead of queueing them to non direct source pads (GOP cache is still updated)",
+            FALSE,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    gst_element_class_set_static_metadata(
+        elementClass,
+        "RtStreaming Fan Out",
+        "Generic",
+        "Sends stream to multiple source pads from shared pool of worker threads",
+        "RtStreaming");
+
+    gst_element_class_add_static_pad_template(elementClass, &SinkTemplate);
+    gst_element_class_add_static_pad_template(elementClass, &SrcTemplate);
+
+    elementClass->request_new_pad = fan_out_request_new_pad;
+    elementClass->release_pad = fan_out_release_pad;
+    elementClass->change_state = fan_out_change_state;
+}
+
+static void fan_out_init(FanOut* self)
+{
+    self->p = new FanOutPrivate;
+
+    self->sinkPad = gst_pad_new_from_static_template(&SinkTemplate, "sink");
+    gst_pad_set_chain_function(self->sinkPad, fan_out_chain);
+    gst_pad_set_chain_list_function(self->sinkPad, fan_out_chain_list);
+    gst_pad_set_event_function(self->sinkPad, fan_out_sink_event);
+    GST_PAD_SET_PROXY_CAPS(self->sinkPad);
+
+    gst_element_add_pad(GST_ELEMENT_CAST(self), self->sinkPad);
+}
+
+gboolean fan_out_register()
+{
+    return gst_element_register(nullptr, FAN_OUT_FACTORY_NAME, GST_RANK_NONE, FAN_OUT_TYPE);
+}
+
+guint64 fan_out_pushed_bytes()
+{
+    return PushedBytes;
+}
+
+namespace {
+
+GThreadPool* WorkersPool() noexcept
+{
+    // intentionally never freed: workers are shared by all fan outs in process
+    static GThreadPool* pool =
+        g_thread_pool_new(
+            [] (gpointer data, gpointer) {
+                fan_out_pad_drain(_FAN_OUT_PAD(data));
+            },
+            nullptr,
+            g_get_num_processors(),
+            TRUE,
+            nullptr);
+
+    return pool;
+}
+
+// single thread holding pads paced for a while, so workers never sleep
+struct PacingScheduler
+{
+    PacingScheduler() noexcept;
+
+    void schedule(FanOutPad*, gint64 deadline) noexcept;
+    void run() noexcept;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::multimap<gint64, FanOutPad*> pads; // deadline -> referenced pad
+};
+
+PacingScheduler::PacingScheduler() noexcept
+{
+    std::thread([this] () { run(); }).detach();
+}
+
+void PacingScheduler::schedule(FanOutPad* pad, gint64 deadline) noexcept
+{
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        earliest = pads.emplace(deadline, pad) == pads.begin();
+    }
+
+    if(earliest)
+        wakeUp.notify_one();
+}
+
+void PacingScheduler::run() noexcept
+{
+    std::vector<FanOutPad*> duePads;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;) {
+        if(pads.empty()) {
+            wakeUp.wait(lock);
+            continue;
+        }
+
+        const gint64 now = g_get_monotonic_time();
+        const gint64 deadline = pads.begin()->first;
+        if(deadline > now) {
+            wakeUp.wait_for(lock, std::chrono::microseconds(deadline - now));
+            continue;
+        }
+
+        for(auto it = pads.begin(); it != pads.end() && it->first <= now;) {
+            duePads.push_back(it->second);
+            it = pads.erase(it);
+        }
+
+        lock.unlock();
+        // pad is still scheduled, so ownership of reference goes back to pool
+        for(FanOutPad* pad: duePads)
+            g_thread_pool_push(WorkersPool(), pad, nullptr);
+        duePads.clear();
+        lock.lock();
+    }
+}
+
+void SchedulePacedPad(FanOutPad* pad, gint64 deadline) noexcept
+{
+    // intentionally never freed: pacer is shared by all fan outs in process
+    static PacingScheduler* scheduler = new PacingScheduler();
+
+    scheduler->schedule(pad, deadline);
+}
+
+}
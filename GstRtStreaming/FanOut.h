@@ -0,0 +1,31 @@
+#pragma once
+
+#include <gst/gst.h>
+
+
+G_BEGIN_DECLS
+
+#define FAN_OUT_FACTORY_NAME "rtfanout"
+
+// tee replacement: every "src_%u" pad has own bounded queue
+// and is pushed from process wide pool of O(cores) worker threads
+#define FAN_OUT_TYPE fan_out_get_type()
+G_DECLARE_FINAL_TYPE(FanOut, fan_out, , FAN_OUT, GstElement)
+
+#define FAN_OUT_PAD_TYPE fan_out_pad_get_type()
+G_DECLARE_FINAL_TYPE(FanOutPad, fan_out_pad, , FAN_OUT_PAD, GstPad)
+
+// values of "degradation" property of FanOutPad
+typedef enum {
+    FAN_OUT_PAD_DEGRADATION_NONE = 0,
+    FAN_OUT_PAD_DEGRADATION_REDUCED_QUEUE = 1, // overflow (and skip to next key frame) happens earlier
+    FAN_OUT_PAD_DEGRADATION_KEY_FRAMES_ONLY = 2,
+} FanOutPadDegradation;
+
+gboolean fan_out_register();
+
+// thread safe
+// process wide number of bytes pushed from all "src_%u" pads except direct ones (fakesink etc.)
+guint64 fan_out_pushed_bytes();
+
+G_END_DECLS
@@ -0,0 +1,219 @@
+#include "GstAdmissionController.h"
+
+#include <cstring>
+#include <mutex>
+
+#include <glib.h>
+
+#include <CxxPtr/GlibPtr.h>
+
+#include "Log.h"
+#include "Helpers.h"
+#include "FanOut.h"
+#include "GstLoadGovernor.h"
+
+
+using namespace GstRtStreaming;
+
+namespace {
+
+const gint64 SampleInterval = G_USEC_PER_SEC;
+
+#if defined(__linux__)
+// value of "<name>:" line of /proc/self/status
+guint64 ProcStatusValue(const gchar* status, const gchar* name)
+{
+    const size_t nameLength = strlen(name);
+    for(const gchar* line = status; line && *line; ) {
+        if(0 == strncmp(line, name, nameLength) && line[nameLength] == ':')
+            return g_ascii_strtoull(line + nameLength + 1, nullptr, 10);
+
+        line = strchr(line, '\n');
+        if(line)
+            ++line;
+    }
+
+    return 0;
+}
+
+unsigned SocketsCount()
+{
+    GDir* dir = g_dir_open("/proc/self/fd", 0, nullptr);
+    if(!dir)
+        return 0;
+
+    unsigned count = 0;
+    while(const gchar* name = g_dir_read_name(dir)) {
+        GCharPtr pathPtr(g_build_filename("/proc/self/fd", name, nullptr));
+        GCharPtr targetPtr(g_file_read_link(pathPtr.get(), nullptr));
+        if(targetPtr && g_str_has_prefix(targetPtr.get(), "socket:"))
+            ++count;
+    }
+
+    g_dir_close(dir);
+
+    return count;
+}
+#endif
+
+}
+
+struct GstAdmissionController::Private
+{
+    void sample() noexcept;
+    AdmissionResult check() const noexcept;
+
+    const std::shared_ptr<spdlog::logger> log = GstRtStreamingLog();
+
+    std::mutex mutex;
+    Thresholds thresholds;
+
+    gint64 lastSampleTime = 0;
+    gint64 lastCpuTime = 0;
+    guint64 lastPushedBytes = 0;
+
+    Signals signals;
+    Stats stats;
+};
+
+// should be called with mutex locked
+void GstAdmissionController::Private::sample() noexcept
+{
+    const gint64 now = g_get_monotonic_time();
+    if(lastSampleTime && now - lastSampleTime < SampleInterval)
+        return;
+
+    const gint64 cpuTime = ProcessCpuTime();
+    const guint64 pushedBytes = fan_out_pushed_bytes();
+
+    signals.peers = GstLoadGovernor::stats().peers;
+
+    if(lastSampleTime) {
+        const gint64 elapsed = now - lastSampleTime;
+        signals.cpuLoad =
+            unsigned(double(cpuTime - lastCpuTime) * 100 / (double(elapsed) * g_get_num_processors()));
+        signals.egressBitrate =
+            (pushedBytes - lastPushedBytes) * 8 * G_USEC_PER_SEC / elapsed;
+    }
+
+    if(signals.peers) {
+        signals.cpuLoadPerPeer = signals.cpuLoad * 100 / signals.peers;
+        signals.egressBitratePerPeer = signals.egressBitrate / signals.peers;
+    } else {
+        signals.cpuLoadPerPeer = 0;
+        signals.egressBitratePerPeer = 0;
+    }
+
+#if defined(__linux__)
+    gchar* status = nullptr;
+    if(g_file_get_contents("/proc/self/status", &status, nullptr, nullptr)) {
+        GCharPtr statusPtr(status);
+        signals.threads = ProcStatusValue(status, "Threads");
+        signals.memory = ProcStatusValue(status, "VmRSS") * 1024; // reported in kB
+    }
+#endif
+
+    lastSampleTime = now;
+    lastCpuTime = cpuTime;
+    lastPushedBytes = pushedBytes;
+}
+
+// should be called with mutex locked
+AdmissionResult GstAdmissionController::Private::check() const noexcept
+{
+    // load is projected with cost of one more peer
+    if(thresholds.peers && signals.peers + 1 > thresholds.peers)
+        return AdmissionResult::PeerLimit;
+
+    if(thresholds.cpuLoad &&
+        signals.cpuLoad * 100 + signals.cpuLoadPerPeer > thresholds.cpuLoad * 100)
+    {
+        return AdmissionResult::CpuLimit;
+    }
+
+    if(thresholds.egressBitrate &&
+        signals.egressBitrate + signals.egressBitratePerPeer > thresholds.egressBitrate)
+    {
+        return AdmissionResult::EgressLimit;
+    }
+
+    if(thresholds.threads && signals.threads && signals.threads >= thresholds.threads)
+        return AdmissionResult::ThreadLimit;
+
+    if(thresholds.memory && signals.memory && signals.memory >= thresholds.memory)
+        return AdmissionResult::MemoryLimit;
+
+    return AdmissionResult::Admitted;
+}
+
+GstAdmissionController::Private& GstAdmissionController::Instance() noexcept
+{
+    static Private* instance = new Private();
+    return *instance;
+}
+
+void GstAdmissionController::SetThresholds(const Thresholds& thresholds) noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    instance.thresholds = thresholds;
+}
+
+GstAdmissionController::Signals GstAdmissionController::signals() noexcept
+{
+    Private& instance = Instance();
+
+    Signals signals;
+    {
+        std::lock_guard<std::mutex> lock(instance.mutex);
+
+        instance.sample();
+
+        signals = instance.signals;
+    }
+
+#if defined(__linux__)
+    // walks all descriptors, so it's diagnostic only and is not sampled for admission
+    signals.sockets = SocketsCount();
+#endif
+
+    return signals;
+}
+
+AdmissionResult GstAdmissionController::Admit(PeerPriority priority) noexcept
+{
+    Private& instance = Instance();
+
+    // sources on different shards can admit peers concurrently
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    instance.sample();
+
+    const AdmissionResult result =
+        priority == PeerPriority::High ?
+            AdmissionResult::Admitted :
+            instance.check();
+
+    if(result == AdmissionResult::Admitted) {
+        ++instance.stats.admitted;
+        // peers admitted within one sample interval are counted right away,
+        // so flash crowd can't pass on stale values
+        ++instance.signals.peers;
+        instance.signals.cpuLoad += instance.signals.cpuLoadPerPeer / 100;
+        instance.signals.egressBitrate += instance.signals.egressBitratePerPeer;
+    } else {
+        ++instance.stats.rejected;
+        instance.log->warn("New peer rejected: {}", static_cast<int>(result));
+    }
+
+    return result;
+}
+
+GstAdmissionController::Stats GstAdmissionController::stats() noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    return instance.stats;
+}
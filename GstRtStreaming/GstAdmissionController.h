@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Types.h"
+
+
+// Decides if one more peer can be created on this node
+// based on measured capacity signals.
+// Thread safe
+class GstAdmissionController
+{
+public:
+    // 0 = not limited
+    struct Thresholds {
+        unsigned peers = 0;
+        unsigned cpuLoad = 0; // percents of all cores
+        uint64_t egressBitrate = 0; // bits per second
+        unsigned threads = 0;
+        uint64_t memory = 0; // resident set size in bytes
+    };
+
+    // threads and memory are available on Linux only (0 otherwise)
+    struct Signals {
+        unsigned peers = 0;
+        unsigned cpuLoad = 0; // percents of all cores
+        unsigned cpuLoadPerPeer = 0; // estimated, in hundredths of percent
+        uint64_t egressBitrate = 0; // bits per second
+        uint64_t egressBitratePerPeer = 0;
+        unsigned threads = 0;
+        uint64_t memory = 0;
+        unsigned sockets = 0; // open socket descriptors (ICE candidates, TURN allocations etc.)
+    };
+
+    struct Stats {
+        uint64_t admitted = 0;
+        uint64_t rejected = 0;
+    };
+
+    static void SetThresholds(const Thresholds&) noexcept;
+
+    // values are resampled if older than 1 second,
+    // sockets are counted on every call
+    static Signals signals() noexcept;
+
+    // peer is admitted if projected load with one more peer doesn't exceed thresholds.
+    // High priority peers are always admitted
+    static GstRtStreaming::AdmissionResult Admit(GstRtStreaming::PeerPriority) noexcept;
+
+    static Stats stats() noexcept;
+
+private:
+    struct Private;
+    static Private& Instance() noexcept;
+};
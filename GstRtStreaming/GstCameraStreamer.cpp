@@ -40,14 +40,14 @@ bool GstCameraStreamer::prepare() noexcept
             "capsfilter name=cameraFilter ! "
             "v4l2h264enc ! "
             "capsfilter name=encoderFilter ! "
-            "rtph264pay pt=99 config-interval=-1 ! tee name = tee";
+            "rtph264pay pt=99 config-interval=-1 ! " FAN_OUT_FACTORY_NAME " name=tee";
     } else {
         pipelineDesc =
             "libcamerasrc ! "
             "capsfilter name=cameraFilter ! "
             "x264enc ! "
             "capsfilter name=encoderFilter ! "
-            "rtph264pay pt=99 config-interval=-1 ! tee name = tee";
+            "rtph264pay pt=99 config-interval=-1 ! " FAN_OUT_FACTORY_NAME " name=tee";
     }
 
     GError* parseError = nullptr;
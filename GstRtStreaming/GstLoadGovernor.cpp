@@ -0,0 +1,306 @@
+#include "GstLoadGovernor.h"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "Log.h"
+#include "Helpers.h"
+#include "FanOut.h"
+#include "GstWebRTCPeer2.h"
+#include "GstSourceShards.h"
+
+
+using namespace GstRtStreaming;
+
+namespace {
+
+const std::chrono::milliseconds SampleInterval(500);
+
+struct Entry
+{
+    GstWebRTCPeer2* peer;
+    PeerPriority priority;
+    FanOutPadDegradation degradation;
+    bool disconnected;
+    // peers can live on different source shards,
+    // so governor works with thread safe fan out pad and webrtcbin directly
+    GstPadPtr teePadPtr;
+    GstElementPtr rtcbinPtr;
+};
+
+unsigned QueueFillLevel(GstPad* teePad)
+{
+    guint fillLevel = 0;
+    g_object_get(teePad, "fill-level", &fillLevel, nullptr);
+
+    return fillLevel;
+}
+
+unsigned Percents(double value, double threshold)
+{
+    return threshold > 0 ? unsigned(value * 100 / threshold) : 0;
+}
+
+GstLoadGovernor::Level LevelFor(unsigned overload)
+{
+    if(overload >= 150)
+        return GstLoadGovernor::Level::Critical;
+    else if(overload >= 125)
+        return GstLoadGovernor::Level::High;
+    else if(overload >= 100)
+        return GstLoadGovernor::Level::Elevated;
+    else
+        return GstLoadGovernor::Level::Normal;
+}
+
+FanOutPadDegradation DegradationFor(PeerPriority priority, GstLoadGovernor::Level level)
+{
+    using Level = GstLoadGovernor::Level;
+
+    switch(priority) {
+    case PeerPriority::High:
+        break;
+    case PeerPriority::Normal:
+        if(level == Level::Critical)
+            return FAN_OUT_PAD_DEGRADATION_KEY_FRAMES_ONLY;
+        else if(level == Level::High)
+            return FAN_OUT_PAD_DEGRADATION_REDUCED_QUEUE;
+        break;
+    case PeerPriority::Low:
+        if(level >= Level::High)
+            return FAN_OUT_PAD_DEGRADATION_KEY_FRAMES_ONLY;
+        else if(level == Level::Elevated)
+            return FAN_OUT_PAD_DEGRADATION_REDUCED_QUEUE;
+        break;
+    }
+
+    return FAN_OUT_PAD_DEGRADATION_NONE;
+}
+
+}
+
+struct GstLoadGovernor::Private
+{
+    void start() noexcept;
+    void stop() noexcept;
+
+    void sample() noexcept;
+    void apply() noexcept;
+
+    const std::shared_ptr<spdlog::logger> log = GstRtStreamingLog();
+
+    std::mutex mutex;
+    Thresholds thresholds;
+    std::vector<Entry> entries;
+
+    guint timeoutId = 0;
+    gint64 lastSampleTime = 0;
+    gint64 lastCpuTime = 0;
+
+    Stats stats;
+};
+
+// should be called with mutex locked
+void GstLoadGovernor::Private::start() noexcept
+{
+    if(timeoutId)
+        return;
+
+    lastSampleTime = g_get_monotonic_time();
+    lastCpuTime = ProcessCpuTime();
+
+    auto onSampleTimeout =
+        + [] (gpointer userData) -> gboolean {
+            static_cast<Private*>(userData)->sample();
+            return G_SOURCE_CONTINUE;
+        };
+    timeoutId = g_timeout_add(SampleInterval.count(), onSampleTimeout, this);
+}
+
+// should be called with mutex locked
+void GstLoadGovernor::Private::stop() noexcept
+{
+    if(!timeoutId)
+        return;
+
+    g_source_remove(timeoutId);
+    timeoutId = 0;
+
+    stats.level = Level::Normal;
+}
+
+void GstLoadGovernor::Private::sample() noexcept
+{
+    using namespace std::chrono;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const gint64 now = g_get_monotonic_time();
+    const gint64 cpuTime = ProcessCpuTime();
+
+    const gint64 elapsed = std::max<gint64>(now - lastSampleTime, 1);
+    // timeout is dispatched late if main loop is busy,
+    // and busiest source shard matters as much as main loop
+    const gint64 lag = std::max<gint64>({
+        elapsed - duration_cast<microseconds>(SampleInterval).count(),
+        duration_cast<microseconds>(GstSourceShards::maxLag()).count(),
+        0 });
+    const double cpuLoad =
+        double(cpuTime - lastCpuTime) * 100 / (double(elapsed) * g_get_num_processors());
+
+    lastSampleTime = now;
+    lastCpuTime = cpuTime;
+
+    unsigned fillSum = 0;
+    for(const Entry& entry: entries) {
+        if(entry.teePadPtr)
+            fillSum += QueueFillLevel(entry.teePadPtr.get());
+    }
+    const unsigned queueFill = entries.empty() ? 0 : fillSum / entries.size();
+
+    stats.mainLoopLag = duration_cast<milliseconds>(microseconds(lag));
+    stats.cpuLoad = unsigned(cpuLoad);
+    stats.queueFill = queueFill;
+
+    const unsigned overload = std::max({
+        Percents(double(stats.mainLoopLag.count()), double(thresholds.mainLoopLag.count())),
+        Percents(cpuLoad, thresholds.cpuLoad),
+        Percents(queueFill, thresholds.queueFill) });
+
+    // raise immediately, but relax step by step to avoid flapping
+    const Level level = LevelFor(overload);
+    Level nextLevel = stats.level;
+    if(level > stats.level)
+        nextLevel = level;
+    else if(level < stats.level)
+        nextLevel = static_cast<Level>(static_cast<int>(stats.level) - 1);
+
+    if(nextLevel == stats.level)
+        return;
+
+    log->info(
+        "Load level changed {} -> {} (main loop lag {}ms, cpu {}%, queue fill {}%)",
+        static_cast<int>(stats.level),
+        static_cast<int>(nextLevel),
+        stats.mainLoopLag.count(),
+        stats.cpuLoad,
+        stats.queueFill);
+
+    stats.level = nextLevel;
+
+    apply();
+}
+
+// should be called with mutex locked
+void GstLoadGovernor::Private::apply() noexcept
+{
+    for(Entry& entry: entries) {
+        if(entry.disconnected)
+            continue;
+
+        if(entry.priority == PeerPriority::Low && stats.level == Level::Critical && entry.rtcbinPtr) {
+            // peer is destroyed asynchronously on its source context, so entries are not modified here.
+            // Peer unregisters itself before destruction, so it's alive while mutex is locked
+            entry.disconnected = true;
+            ++stats.disconnects;
+            GstWebRTCPeer2::Disconnect(entry.rtcbinPtr.get());
+            continue;
+        }
+
+        const FanOutPadDegradation degradation = DegradationFor(entry.priority, stats.level);
+        if(degradation == entry.degradation)
+            continue;
+
+        if(degradation > entry.degradation)
+            ++stats.degradations;
+
+        entry.degradation = degradation;
+        if(entry.teePadPtr)
+            g_object_set(entry.teePadPtr.get(), "degradation", degradation, nullptr);
+    }
+}
+
+GstLoadGovernor::Private& GstLoadGovernor::Instance() noexcept
+{
+    static Private* instance = new Private();
+    return *instance;
+}
+
+void GstLoadGovernor::SetThresholds(const Thresholds& thresholds) noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    instance.thresholds = thresholds;
+}
+
+void GstLoadGovernor::Register(GstWebRTCPeer2* peer, PeerPriority priority) noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    const FanOutPadDegradation degradation = DegradationFor(priority, instance.stats.level);
+    instance.entries.emplace_back(Entry { peer, priority, degradation, false });
+    instance.stats.peers = instance.entries.size();
+
+    instance.start();
+}
+
+void GstLoadGovernor::Attach(
+    GstWebRTCPeer2* peer,
+    GstPadPtr&& teePadPtr,
+    GstElementPtr&& rtcbinPtr) noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    auto it = std::find_if(
+        instance.entries.begin(),
+        instance.entries.end(),
+        [peer] (const Entry& entry) { return entry.peer == peer; });
+    if(it == instance.entries.end())
+        return;
+
+    // degradation could be decided before peer got its pad
+    if(it->degradation != FAN_OUT_PAD_DEGRADATION_NONE)
+        g_object_set(teePadPtr.get(), "degradation", it->degradation, nullptr);
+
+    std::swap(it->teePadPtr, teePadPtr);
+    std::swap(it->rtcbinPtr, rtcbinPtr);
+}
+
+void GstLoadGovernor::Unregister(GstWebRTCPeer2* peer) noexcept
+{
+    Private& instance = Instance();
+
+    // pad and webrtcbin are released outside of lock
+    std::vector<Entry> removed;
+    {
+        std::lock_guard<std::mutex> lock(instance.mutex);
+
+        auto it = std::stable_partition(
+            instance.entries.begin(),
+            instance.entries.end(),
+            [peer] (const Entry& entry) { return entry.peer != peer; });
+        std::move(it, instance.entries.end(), std::back_inserter(removed));
+        instance.entries.erase(it, instance.entries.end());
+        instance.stats.peers = instance.entries.size();
+
+        if(instance.entries.empty())
+            instance.stop();
+    }
+}
+
+GstLoadGovernor::Stats GstLoadGovernor::stats() noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    return instance.stats;
+}
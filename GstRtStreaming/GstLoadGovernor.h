@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+#include "CxxPtr/GstPtr.h"
+
+#include "Types.h"
+
+
+class GstWebRTCPeer2;
+
+// Periodically estimates load (main loop lag, process CPU, fan out queues fill)
+// and degrades peers starting from lowest priority ones.
+// Thread safe, samples are taken on default main context
+class GstLoadGovernor
+{
+public:
+    enum class Level {
+        Normal,
+        Elevated, // Low priority peers get reduced queue
+        High,     // Low priority peers get key frames only, Normal priority peers get reduced queue
+        Critical, // Low priority peers are disconnected, Normal priority peers get key frames only
+    };
+
+    // level is raised when any value exceeds threshold,
+    // and raised further at 1.25x and 1.5x of it
+    struct Thresholds {
+        std::chrono::milliseconds mainLoopLag { 100 };
+        unsigned cpuLoad = 80; // percents of all cores
+        unsigned queueFill = 50; // average over peers, in percents of queue limit
+    };
+
+    struct Stats {
+        unsigned peers = 0;
+        Level level = Level::Normal;
+        std::chrono::milliseconds mainLoopLag {};
+        unsigned cpuLoad = 0;
+        unsigned queueFill = 0;
+        uint64_t degradations = 0;
+        uint64_t disconnects = 0;
+    };
+
+    static void SetThresholds(const Thresholds&) noexcept;
+
+    static void Register(GstWebRTCPeer2*, GstRtStreaming::PeerPriority) noexcept;
+    // should be called when peer gets connected to fan out
+    static void Attach(GstWebRTCPeer2*, GstPadPtr&& teePad, GstElementPtr&& rtcbin) noexcept;
+    static void Unregister(GstWebRTCPeer2*) noexcept;
+
+    static Stats stats() noexcept;
+
+private:
+    struct Private;
+    static Private& Instance() noexcept;
+};
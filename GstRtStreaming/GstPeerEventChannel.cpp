@@ -0,0 +1,336 @@
+#include "GstPeerEventChannel.h"
+
+#include <cassert>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+
+namespace {
+
+typedef GstPeerEventChannel::Event Event;
+
+// bigger payloads are not kept in pool
+const size_t MaxPooledPayloadSize = 16 * 1024;
+// events dispatched per main loop iteration, the rest wait for the next one
+const unsigned MaxDispatchBatch = 256;
+
+struct Record
+{
+    std::atomic<Record*> next { nullptr };
+    MessageProxy* target = nullptr; // referenced
+    gint64 postTime = 0;
+    Event event;
+    std::function<void ()> call;
+};
+
+std::atomic<uint64_t> Posted { 0 };
+std::atomic<uint64_t> Dispatched { 0 };
+std::atomic<uint64_t> Wakeups { 0 };
+std::atomic<uint64_t> Records { 0 };
+std::atomic<int64_t> TotalLatency { 0 }; // microseconds
+std::atomic<int64_t> MaxLatency { 0 }; // microseconds
+
+// released records are pushed one by one, but taken only all at once,
+// so there is no ABA problem
+std::atomic<Record*> FreeRecords { nullptr };
+
+void PushFreeRecords(Record* first, Record* last)
+{
+    Record* head = FreeRecords.load(std::memory_order_relaxed);
+    do {
+        last->next.store(head, std::memory_order_relaxed);
+    } while(!FreeRecords.compare_exchange_weak(
+        head,
+        first,
+        std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+// records taken from pool by producer thread
+struct RecordCache
+{
+    ~RecordCache()
+    {
+        if(!records)
+            return;
+
+        Record* last = records;
+        while(Record* next = last->next.load(std::memory_order_relaxed))
+            last = next;
+
+        PushFreeRecords(records, last);
+    }
+
+    Record* records = nullptr;
+};
+
+thread_local RecordCache Cache;
+
+Record* AcquireRecord()
+{
+    if(!Cache.records)
+        Cache.records = FreeRecords.exchange(nullptr, std::memory_order_acquire);
+
+    if(Record* record = Cache.records) {
+        Cache.records = record->next.load(std::memory_order_relaxed);
+        return record;
+    }
+
+    ++Records;
+
+    return new Record();
+}
+
+void ReleaseRecord(Record* record)
+{
+    g_object_unref(record->target);
+    record->target = nullptr;
+
+    if(record->event.payload.capacity() > MaxPooledPayloadSize)
+        std::string().swap(record->event.payload);
+    else
+        record->event.payload.clear();
+
+    PushFreeRecords(record, record);
+}
+
+void UpdateLatency(gint64 latency)
+{
+    TotalLatency.fetch_add(latency, std::memory_order_relaxed);
+
+    int64_t maxLatency = MaxLatency.load(std::memory_order_relaxed);
+    while(latency > maxLatency &&
+        !MaxLatency.compare_exchange_weak(maxLatency, latency, std::memory_order_relaxed));
+}
+
+// intrusive MPSC queue (D. Vyukov), consumer is the thread running context
+struct Channel
+{
+    explicit Channel(GMainContext*) noexcept;
+
+    void post(Record*) noexcept;
+    void dispatch() noexcept;
+
+    void push(Record*) noexcept;
+    Record* pop() noexcept;
+
+    GSource* source;
+
+    std::atomic<Record*> head;
+    Record* tail; // accessed by consumer only
+    Record stub;
+
+    // context is already woken up and will drain channel
+    std::atomic<bool> signaled { false };
+};
+
+struct ChannelSource
+{
+    GSource source;
+    Channel* channel;
+};
+
+gboolean OnChannelDispatch(GSource* source, GSourceFunc, gpointer)
+{
+    reinterpret_cast<ChannelSource*>(source)->channel->dispatch();
+    return G_SOURCE_CONTINUE;
+}
+
+GSourceFuncs ChannelSourceFuncs = { nullptr, nullptr, OnChannelDispatch, nullptr };
+
+Channel::Channel(GMainContext* context) noexcept :
+    source(g_source_new(&ChannelSourceFuncs, sizeof(ChannelSource))),
+    head(&stub),
+    tail(&stub)
+{
+    reinterpret_cast<ChannelSource*>(source)->channel = this;
+    g_source_set_name(source, "GstPeerEventChannel");
+    g_source_attach(source, context);
+}
+
+void Channel::push(Record* record) noexcept
+{
+    record->next.store(nullptr, std::memory_order_relaxed);
+    Record* prev = head.exchange(record, std::memory_order_acq_rel);
+    prev->next.store(record, std::memory_order_release);
+}
+
+// returns nullptr if queue is empty or producer is in the middle of push,
+// in the latter case producer will wake up context right after push
+Record* Channel::pop() noexcept
+{
+    Record* tail = this->tail;
+    Record* next = tail->next.load(std::memory_order_acquire);
+
+    if(tail == &stub) {
+        if(!next)
+            return nullptr;
+
+        this->tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if(next) {
+        this->tail = next;
+        return tail;
+    }
+
+    if(tail != head.load(std::memory_order_acquire))
+        return nullptr;
+
+    push(&stub);
+
+    next = tail->next.load(std::memory_order_acquire);
+    if(next) {
+        this->tail = next;
+        return tail;
+    }
+
+    return nullptr;
+}
+
+// will be called from any thread
+void Channel::post(Record* record) noexcept
+{
+    push(record);
+
+    // ready time is changed under context lock, so it's done once per batch of events
+    if(!signaled.exchange(true))
+        g_source_set_ready_time(source, 0);
+}
+
+// will be called from thread running context
+void Channel::dispatch() noexcept
+{
+    ++Wakeups;
+
+    g_source_set_ready_time(source, -1);
+    // events posted from now on will wake up context again
+    signaled.exchange(false);
+
+    const gint64 now = g_get_monotonic_time();
+
+    unsigned count = 0;
+    for(; count < MaxDispatchBatch; ++count) {
+        Record* record = pop();
+        if(!record)
+            break;
+
+        UpdateLatency(now > record->postTime ? now - record->postTime : 0);
+
+        if(record->call) {
+            record->call();
+            record->call = nullptr;
+        } else {
+            // peer could be already destroyed, handler is reset in that case
+            message_proxy_dispatch_event(record->target, &record->event);
+        }
+
+        ReleaseRecord(record);
+    }
+
+    Dispatched.fetch_add(count, std::memory_order_relaxed);
+
+    if(count == MaxDispatchBatch)
+        g_source_set_ready_time(source, 0);
+}
+
+Channel* ChannelOf(MessageProxy* messageProxy)
+{
+    return static_cast<Channel*>(message_proxy_get_event_channel(messageProxy));
+}
+
+void Post(
+    MessageProxy* target,
+    Event::Type type,
+    unsigned mlineIndex,
+    bool error,
+    const gchar* payload,
+    std::function<void ()>&& call = nullptr)
+{
+    Channel* channel = ChannelOf(target);
+    assert(channel);
+    if(!channel)
+        return;
+
+    Record* record = AcquireRecord();
+    record->target = static_cast<MessageProxy*>(g_object_ref(target));
+    record->postTime = g_get_monotonic_time();
+    record->call = std::move(call);
+
+    Event& event = record->event;
+    event.type = type;
+    event.mlineIndex = mlineIndex;
+    event.error = error;
+    if(payload)
+        event.payload.assign(payload);
+
+    ++Posted;
+
+    channel->post(record);
+}
+
+}
+
+void GstPeerEventChannel::Bind(MessageProxy* messageProxy, GMainContext* context) noexcept
+{
+    static std::mutex mutex;
+    // intentionally leaked: channels are attached to contexts living until process exit
+    static std::map<GMainContext*, Channel*> channels;
+
+    if(!context)
+        context = g_main_context_default();
+
+    Channel* channel;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        Channel*& contextChannel = channels[context];
+        if(!contextChannel)
+            contextChannel = new Channel(context);
+
+        channel = contextChannel;
+    }
+
+    message_proxy_set_event_channel(messageProxy, channel);
+}
+
+void GstPeerEventChannel::PostIceCandidate(
+    MessageProxy* messageProxy,
+    unsigned mlineIndex,
+    const gchar* candidate) noexcept
+{
+    Post(messageProxy, Event::Type::IceCandidate, mlineIndex, false, candidate);
+}
+
+void GstPeerEventChannel::PostSdp(MessageProxy* messageProxy, const gchar* sdp) noexcept
+{
+    Post(messageProxy, Event::Type::Sdp, 0, false, sdp);
+}
+
+void GstPeerEventChannel::PostEos(MessageProxy* messageProxy, bool error) noexcept
+{
+    Post(messageProxy, Event::Type::Eos, 0, error, nullptr);
+}
+
+void GstPeerEventChannel::PostCall(
+    MessageProxy* messageProxy,
+    std::function<void ()>&& call) noexcept
+{
+    Post(messageProxy, Event::Type::Eos, 0, false, nullptr, std::move(call));
+}
+
+GstPeerEventChannel::Stats GstPeerEventChannel::stats() noexcept
+{
+    Stats stats;
+    stats.posted = Posted.load(std::memory_order_relaxed);
+    stats.dispatched = Dispatched.load(std::memory_order_relaxed);
+    stats.wakeups = Wakeups.load(std::memory_order_relaxed);
+    stats.records = Records.load(std::memory_order_relaxed);
+    stats.totalLatency = std::chrono::microseconds(TotalLatency.load(std::memory_order_relaxed));
+    stats.maxLatency = std::chrono::microseconds(MaxLatency.load(std::memory_order_relaxed));
+
+    return stats;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include <glib.h>
+
+#include "MessageProxy.h"
+
+
+// Delivers peer signaling events (ICE candidates, SDP, EOS) from webrtcbin threads
+// and calls from client threads (see GstThreadSafePeer) to the context peer lives on.
+// There is one channel per GMainContext: lock free multi producer single consumer queue
+// of pooled event records, dispatched directly to handler set on target MessageProxy.
+// Events and calls of the same peer are dispatched in the order they were posted
+class GstPeerEventChannel
+{
+public:
+    struct Event {
+        enum class Type {
+            IceCandidate,
+            Sdp,
+            Eos,
+        };
+
+        Type type = Type::Eos;
+        unsigned mlineIndex = 0;
+        bool error = false;
+        std::string payload; // ICE candidate or SDP, empty candidate means end of candidates
+    };
+
+    struct Stats {
+        uint64_t posted = 0;
+        uint64_t dispatched = 0;
+        uint64_t wakeups = 0; // context wake ups, one can serve many events
+        uint64_t records = 0; // ever allocated, the rest are reused
+        std::chrono::microseconds totalLatency {}; // from post to dispatch
+        std::chrono::microseconds maxLatency {};
+    };
+
+    // should be called before peer gets any chance to post events,
+    // nullptr context means default main context
+    static void Bind(MessageProxy*, GMainContext*) noexcept;
+
+    // thread safe
+    // posting doesn't lock, only first event after channel was drained wakes up context
+    static void PostIceCandidate(MessageProxy*, unsigned mlineIndex, const gchar* candidate) noexcept;
+    static void PostSdp(MessageProxy*, const gchar* sdp) noexcept;
+    static void PostEos(MessageProxy*, bool error) noexcept;
+    // call is made on peer's context, regardless of event handler
+    static void PostCall(MessageProxy*, std::function<void ()>&& call) noexcept;
+
+    // thread safe
+    static Stats stats() noexcept;
+};
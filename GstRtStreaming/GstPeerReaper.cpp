@@ -0,0 +1,179 @@
+#include "GstPeerReaper.h"
+
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+
+#include <gst/gst.h>
+
+#include "Log.h"
+
+
+namespace {
+
+// peer is already gone, so waiting a bit for others leaving costs nothing to viewers
+const std::chrono::milliseconds DefaultBatchWindow(10);
+// batch is reaped right away once it gets that big
+const size_t MaxBatchSize = 128;
+
+struct Task
+{
+    GstElementPtr teePtr;
+    GstPadPtr teePadPtr;
+    GstElementPtr binPtr;
+    std::vector<GstElementPtr> elements;
+};
+
+}
+
+struct GstPeerReaper::Private
+{
+    Private() noexcept;
+
+    void run() noexcept;
+    void reap(std::deque<Task>* batch) noexcept;
+
+    const std::shared_ptr<spdlog::logger> log = MakeGstRtStreamingMtLogger("GstPeerReaper");
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Task> tasks;
+    std::chrono::milliseconds batchWindow = DefaultBatchWindow;
+
+    Stats stats;
+};
+
+GstPeerReaper::Private::Private() noexcept
+{
+    std::thread(&Private::run, this).detach();
+}
+
+void GstPeerReaper::Private::run() noexcept
+{
+    for(;;) {
+        std::deque<Task> batch;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] () { return !tasks.empty(); });
+
+            // detaches of join/leave storm are coalesced within window started by the first one
+            condition.wait_for(
+                lock,
+                batchWindow,
+                [this] () { return tasks.size() >= MaxBatchSize; });
+
+            batch.swap(tasks);
+        }
+
+        reap(&batch);
+    }
+}
+
+void GstPeerReaper::Private::reap(std::deque<Task>* batch) noexcept
+{
+    using namespace std::chrono;
+
+    const steady_clock::time_point batchStart = steady_clock::now();
+    microseconds maxTeardownTime {};
+
+    // it looks like order of state change is important
+    // since fan out's worker can be blocked by probe deep inside webrtcbin,
+    // and pad release waits for worker to finish with pad
+    for(Task& task: *batch) {
+        const steady_clock::time_point teardownStart = steady_clock::now();
+
+        for(GstElementPtr& elementPtr: task.elements)
+            gst_element_set_state(elementPtr.get(), GST_STATE_NULL);
+
+        maxTeardownTime = std::max(
+            maxTeardownTime,
+            duration_cast<microseconds>(steady_clock::now() - teardownStart));
+    }
+
+    for(Task& task: *batch) {
+        GstPad* teePad = task.teePadPtr.get();
+        if(!teePad)
+            continue;
+
+        GstPadPtr peerPadPtr(gst_pad_get_peer(teePad));
+        if(peerPadPtr)
+            gst_pad_unlink(teePad, peerPadPtr.get());
+        gst_element_release_request_pad(task.teePtr.get(), teePad);
+    }
+
+    for(Task& task: *batch) {
+        GstBin* bin = GST_BIN(task.binPtr.get());
+        for(GstElementPtr& elementPtr: task.elements)
+            gst_bin_remove(bin, elementPtr.get());
+    }
+
+    const microseconds batchTime = duration_cast<microseconds>(steady_clock::now() - batchStart);
+
+    log->trace(
+        "{} peer(s) reaped in {} us",
+        batch->size(),
+        batchTime.count());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.reapedPeers += batch->size();
+    stats.batches += 1;
+    stats.maxBatchSize = std::max<unsigned>(stats.maxBatchSize, batch->size());
+    stats.pendingPeers -= batch->size();
+    stats.totalTeardownTime += batchTime;
+    stats.maxTeardownTime = std::max(stats.maxTeardownTime, maxTeardownTime);
+}
+
+GstPeerReaper::Private& GstPeerReaper::Instance() noexcept
+{
+    // intentionally leaked: reaper thread lives until process exit
+    static Private* instance = new Private();
+    return *instance;
+}
+
+void GstPeerReaper::Reap(
+    GstElementPtr&& binPtr,
+    std::vector<GstElementPtr>&& elements) noexcept
+{
+    Detach(GstElementPtr(), GstPadPtr(), std::move(binPtr), std::move(elements));
+}
+
+void GstPeerReaper::Detach(
+    GstElementPtr&& teePtr,
+    GstPadPtr&& teePadPtr,
+    GstElementPtr&& binPtr,
+    std::vector<GstElementPtr>&& elements) noexcept
+{
+    Private& instance = Instance();
+
+    {
+        std::lock_guard<std::mutex> lock(instance.mutex);
+        instance.tasks.emplace_back(
+            Task {
+                std::move(teePtr),
+                std::move(teePadPtr),
+                std::move(binPtr),
+                std::move(elements) });
+        instance.stats.pendingPeers += 1;
+    }
+
+    instance.condition.notify_one();
+}
+
+void GstPeerReaper::SetBatchWindow(std::chrono::milliseconds window) noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    instance.batchWindow = window;
+}
+
+GstPeerReaper::Stats GstPeerReaper::stats() noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    return instance.stats;
+}
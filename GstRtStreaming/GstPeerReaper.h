@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#include "CxxPtr/GstPtr.h"
+
+
+// Shuts down and removes detached peer elements on dedicated thread,
+// so slow webrtcbin teardown never runs inside streaming thread
+class GstPeerReaper
+{
+public:
+    struct Stats {
+        uint64_t reapedPeers = 0;
+        uint64_t batches = 0;
+        unsigned maxBatchSize = 0;
+        unsigned pendingPeers = 0;
+        std::chrono::microseconds totalTeardownTime {};
+        std::chrono::microseconds maxTeardownTime {}; // per peer
+    };
+
+    // thread safe
+    // elements will be switched to GST_STATE_NULL in the given order
+    // and then removed from bin
+    static void Reap(GstElementPtr&& binPtr, std::vector<GstElementPtr>&& elements) noexcept;
+
+    // thread safe
+    // the same as Reap, but after elements are switched to GST_STATE_NULL
+    // teePad is unlinked and released from tee;
+    // detaches requested within batch window are done in one pass
+    static void Detach(
+        GstElementPtr&& teePtr,
+        GstPadPtr&& teePadPtr,
+        GstElementPtr&& binPtr,
+        std::vector<GstElementPtr>&& elements) noexcept;
+
+    // thread safe
+    // 10ms by default, 0 - every detach is reaped as soon as possible
+    static void SetBatchWindow(std::chrono::milliseconds) noexcept;
+
+    // thread safe
+    static Stats stats() noexcept;
+
+private:
+    struct Private;
+    static Private& Instance() noexcept;
+};
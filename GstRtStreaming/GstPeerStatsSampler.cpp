@@ -0,0 +1,296 @@
+#include "GstPeerStatsSampler.h"
+
+#include <cmath>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <gst/gst.h>
+
+#include "GstWebRTCPeerBase.h"
+
+
+namespace {
+
+// webrtcbin doesn't reply in some states, so request is retried after that period
+const gint64 PendingRequestTimeout = 5 * G_USEC_PER_SEC;
+
+struct Entry
+{
+    uint64_t id;
+    GstElementPtr rtcbinPtr;
+    gint64 requestTime = 0; // of pending request
+    std::deque<GstPeerStatsSampler::Sample> history;
+};
+
+struct Request
+{
+    const WebRTCPeer* peer;
+    uint64_t id;
+    GstElementPtr rtcbinPtr;
+};
+
+// nearest rank
+GstPeerStatsSampler::Percentiles CalcPercentiles(std::vector<double>* values)
+{
+    GstPeerStatsSampler::Percentiles percentiles;
+    if(values->empty())
+        return percentiles;
+
+    std::sort(values->begin(), values->end());
+
+    auto percentile = [values] (double p) {
+        const size_t rank = static_cast<size_t>(std::ceil(p * values->size()));
+        return (*values)[std::max<size_t>(rank, 1) - 1];
+    };
+
+    percentiles.p50 = percentile(0.50);
+    percentiles.p95 = percentile(0.95);
+    percentiles.p99 = percentile(0.99);
+
+    return percentiles;
+}
+
+}
+
+struct GstPeerStatsSampler::Private
+{
+    Private() noexcept;
+
+    void tick() noexcept;
+    void onStats(const WebRTCPeer*, uint64_t id, const WebRTCPeer::Stats&) noexcept;
+
+    GMainContext* context;
+
+    std::mutex mutex;
+    GSource* timeoutSource = nullptr;
+    unsigned maxRequestsPerTick = 0;
+    std::map<const WebRTCPeer*, Entry> entries;
+    uint64_t nextId = 0;
+    const WebRTCPeer* lastRequested = nullptr;
+
+    Stats stats;
+};
+
+GstPeerStatsSampler::Private::Private() noexcept :
+    context(g_main_context_new())
+{
+    std::thread([] (GMainContext* context) {
+        g_main_context_push_thread_default(context);
+        GMainLoop* loop = g_main_loop_new(context, FALSE);
+        g_main_loop_run(loop);
+    }, context).detach();
+}
+
+// will be called from sampler thread
+void GstPeerStatsSampler::Private::tick() noexcept
+{
+    const gint64 tickStart = g_get_monotonic_time();
+
+    std::vector<Request> requests;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // round robin, so every peer is sampled even if requests per tick are limited
+        auto it = entries.upper_bound(lastRequested);
+        for(size_t i = 0; i < entries.size() && requests.size() < maxRequestsPerTick; ++i, ++it) {
+            if(it == entries.end())
+                it = entries.begin();
+
+            Entry& entry = it->second;
+            lastRequested = it->first;
+
+            if(entry.requestTime && tickStart - entry.requestTime < PendingRequestTimeout) {
+                ++stats.skipped;
+                continue;
+            }
+
+            entry.requestTime = tickStart;
+            requests.emplace_back(Request {
+                it->first,
+                entry.id,
+                GstElementPtr(GST_ELEMENT(gst_object_ref(entry.rtcbinPtr.get()))) });
+        }
+
+        stats.requests += requests.size();
+    }
+
+    for(const Request& request: requests) {
+        const WebRTCPeer* peer = request.peer;
+        const uint64_t id = request.id;
+        GstWebRTCPeerBase::RequestStats(
+            request.rtcbinPtr.get(),
+            [peer, id] (const WebRTCPeer::Stats& stats) {
+                GstPeerStatsSampler::Instance().onStats(peer, id, stats);
+            });
+    }
+
+    const std::chrono::microseconds tickCost(g_get_monotonic_time() - tickStart);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.totalCost += tickCost;
+    stats.maxTickCost = std::max(stats.maxTickCost, tickCost);
+}
+
+// will be called from webrtcbin thread
+void GstPeerStatsSampler::Private::onStats(
+    const WebRTCPeer* peer,
+    uint64_t id,
+    const WebRTCPeer::Stats& peerStats) noexcept
+{
+    const gint64 now = g_get_monotonic_time();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ++stats.replies;
+
+    auto it = entries.find(peer);
+    // peer could be gone and its address reused while request was pending
+    if(it == entries.end() || it->second.id != id)
+        return;
+
+    Entry& entry = it->second;
+    entry.requestTime = 0;
+
+    Sample sample;
+    sample.time = now;
+    sample.stats = peerStats;
+    if(!entry.history.empty()) {
+        const Sample& previous = entry.history.back();
+        if(sample.time > previous.time && peerStats.bytesSent >= previous.stats.bytesSent) {
+            sample.sendBitrate =
+                (peerStats.bytesSent - previous.stats.bytesSent) * 8 * G_USEC_PER_SEC /
+                (sample.time - previous.time);
+        }
+    }
+
+    entry.history.emplace_back(sample);
+    if(entry.history.size() > HistorySize)
+        entry.history.pop_front();
+
+    stats.totalCost += std::chrono::microseconds(g_get_monotonic_time() - now);
+}
+
+GstPeerStatsSampler::Private& GstPeerStatsSampler::Instance() noexcept
+{
+    // intentionally leaked: sampler thread lives until process exit
+    static Private* instance = new Private();
+    return *instance;
+}
+
+void GstPeerStatsSampler::Start(
+    std::chrono::milliseconds interval,
+    unsigned maxRequestsPerTick) noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    if(instance.timeoutSource) {
+        g_source_destroy(instance.timeoutSource);
+        g_source_unref(instance.timeoutSource);
+        instance.timeoutSource = nullptr;
+    }
+
+    instance.maxRequestsPerTick = maxRequestsPerTick;
+
+    if(interval.count() <= 0)
+        return;
+
+    instance.timeoutSource = g_timeout_source_new(interval.count());
+    g_source_set_callback(
+        instance.timeoutSource,
+        [] (gpointer userData) -> gboolean {
+            static_cast<Private*>(userData)->tick();
+            return G_SOURCE_CONTINUE;
+        },
+        &instance,
+        nullptr);
+    g_source_attach(instance.timeoutSource, instance.context);
+}
+
+void GstPeerStatsSampler::Register(const WebRTCPeer* peer, GstElementPtr&& rtcbinPtr) noexcept
+{
+    if(!rtcbinPtr)
+        return;
+
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    Entry& entry = instance.entries[peer];
+    entry = Entry { ++instance.nextId, std::move(rtcbinPtr) };
+}
+
+void GstPeerStatsSampler::Unregister(const WebRTCPeer* peer) noexcept
+{
+    Private& instance = Instance();
+
+    // webrtcbin is released outside of lock
+    GstElementPtr rtcbinPtr;
+    {
+        std::lock_guard<std::mutex> lock(instance.mutex);
+
+        auto it = instance.entries.find(peer);
+        if(it == instance.entries.end())
+            return;
+
+        rtcbinPtr = std::move(it->second.rtcbinPtr);
+        instance.entries.erase(it);
+    }
+}
+
+std::vector<GstPeerStatsSampler::Sample> GstPeerStatsSampler::history(const WebRTCPeer* peer) noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+
+    auto it = instance.entries.find(peer);
+    if(it == instance.entries.end())
+        return {};
+
+    return std::vector<Sample>(it->second.history.begin(), it->second.history.end());
+}
+
+GstPeerStatsSampler::Aggregates GstPeerStatsSampler::aggregates() noexcept
+{
+    Private& instance = Instance();
+
+    std::vector<double> roundTripTimes;
+    std::vector<double> fractionsLost;
+    std::vector<double> sendBitrates;
+    {
+        std::lock_guard<std::mutex> lock(instance.mutex);
+
+        for(const auto& pair: instance.entries) {
+            const Entry& entry = pair.second;
+            if(entry.history.empty())
+                continue;
+
+            const Sample& sample = entry.history.back();
+            if(sample.stats.roundTripTime >= 0)
+                roundTripTimes.push_back(sample.stats.roundTripTime);
+            fractionsLost.push_back(sample.stats.fractionLost);
+            sendBitrates.push_back(double(sample.sendBitrate));
+        }
+    }
+
+    Aggregates aggregates;
+    aggregates.peers = sendBitrates.size();
+    aggregates.roundTripTime = CalcPercentiles(&roundTripTimes);
+    aggregates.fractionLost = CalcPercentiles(&fractionsLost);
+    aggregates.sendBitrate = CalcPercentiles(&sendBitrates);
+
+    return aggregates;
+}
+
+GstPeerStatsSampler::Stats GstPeerStatsSampler::stats() noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    return instance.stats;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#include "CxxPtr/GstPtr.h"
+
+#include "../WebRTCPeer.h"
+
+
+// Periodically requests stats of all registered peers on dedicated thread,
+// keeps per peer history and cross peer aggregates.
+// Sampling cost is bounded by number of requests per tick
+class GstPeerStatsSampler
+{
+public:
+    enum {
+        HistorySize = 60,
+    };
+
+    struct Sample {
+        int64_t time = 0; // g_get_monotonic_time()
+        WebRTCPeer::Stats stats;
+        uint64_t sendBitrate = 0; // bits per second, since previous sample
+    };
+
+    struct Percentiles {
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+    };
+
+    // over latest samples of all peers
+    struct Aggregates {
+        unsigned peers = 0;
+        Percentiles roundTripTime; // seconds, peers without RTT are not counted
+        Percentiles fractionLost;
+        Percentiles sendBitrate;
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t replies = 0;
+        uint64_t skipped = 0; // previous request of peer was still pending
+        std::chrono::microseconds totalCost {}; // requesting and storing samples
+        std::chrono::microseconds maxTickCost {};
+    };
+
+    // thread safe
+    // interval 0 stops sampling
+    static void Start(std::chrono::milliseconds interval, unsigned maxRequestsPerTick = 50) noexcept;
+
+    // thread safe
+    static void Register(const WebRTCPeer*, GstElementPtr&& rtcbinPtr) noexcept;
+    static void Unregister(const WebRTCPeer*) noexcept;
+
+    // thread safe
+    // oldest sample first
+    static std::vector<Sample> history(const WebRTCPeer*) noexcept;
+    static Aggregates aggregates() noexcept;
+    static Stats stats() noexcept;
+
+private:
+    struct Private;
+    static Private& Instance() noexcept;
+};
@@ -38,7 +38,7 @@ bool GstPipelineStreamer2::prepare() noexcept
     gst_bin_add(GST_BIN(pipeline), sourceBin);
     gst_element_sync_state_with_parent(sourceBin);
 
-    GstElementPtr teePtr(gst_element_factory_make("tee", nullptr));
+    GstElementPtr teePtr(gst_element_factory_make(FAN_OUT_FACTORY_NAME, nullptr));
     GstElement* tee = teePtr.get();
     if(!tee)
         return false;
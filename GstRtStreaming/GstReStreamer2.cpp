@@ -142,7 +142,7 @@ void GstReStreamer2::srcPadAdded(
     } else
         return;
 
-    GstElementPtr teePtr(gst_element_factory_make("tee", nullptr));
+    GstElementPtr teePtr(gst_element_factory_make(FAN_OUT_FACTORY_NAME, nullptr));
     GstElement* tee = teePtr.get();
     gst_bin_add(GST_BIN(pipeline), GST_ELEMENT(gst_object_ref(tee)));
     gst_element_sync_state_with_parent(tee);
@@ -223,7 +223,7 @@ void GstRecordStreamer::srcPadAdded(
     if(GST_PAD_LINK_OK != gst_pad_link(pad, sink))
         assert(false);
 
-    GstElementPtr teePtr(gst_element_factory_make("tee", nullptr));
+    GstElementPtr teePtr(gst_element_factory_make(FAN_OUT_FACTORY_NAME, nullptr));
     GstElement* tee = teePtr.get();
     gst_bin_add(GST_BIN(pipeline), GST_ELEMENT(gst_object_ref(tee)));
     gst_element_sync_state_with_parent(tee);
@@ -422,6 +422,11 @@ void GstRecordStreamer::onPeerAttached() noexcept
     // just to ignore implementation from parent
 }
 
+void GstRecordStreamer::onLastPeerPaused() noexcept
+{
+    // recording should not be interrupted
+}
+
 void GstRecordStreamer::onLastPeerDetached() noexcept
 {
     // pipeline should be active while record peer is active
@@ -32,6 +32,7 @@ protected:
     void onPrerolled() noexcept override;
     void onPeerAttached() noexcept override;
     void onLastPeerDetached() noexcept override;
+    void onLastPeerPaused() noexcept override;
 
 private:
     const std::shared_ptr<spdlog::logger>& log() const
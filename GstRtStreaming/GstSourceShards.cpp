@@ -0,0 +1,95 @@
+#include "GstSourceShards.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+const guint LagSampleInterval = 500; // ms
+
+struct Shard
+{
+    GMainContext* context;
+    std::atomic<gint64> lag { 0 }; // microseconds
+    gint64 lastSampleTime = 0;
+};
+
+}
+
+struct GstSourceShards::Private
+{
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<unsigned> next { 0 };
+};
+
+GstSourceShards::Private& GstSourceShards::Instance() noexcept
+{
+    // intentionally leaked: shard threads live until process exit
+    static Private* instance = new Private();
+    return *instance;
+}
+
+void GstSourceShards::Init(unsigned count) noexcept
+{
+    Private& instance = Instance();
+
+    g_return_if_fail(instance.shards.empty());
+
+    for(unsigned i = 0; i < count; ++i) {
+        Shard* shard = new Shard { g_main_context_new() };
+        instance.shards.emplace_back(shard);
+
+        std::thread([shard] () {
+            g_main_context_push_thread_default(shard->context);
+
+            // timeout is dispatched late if shard is busy
+            GSource* lagSource = g_timeout_source_new(LagSampleInterval);
+            g_source_set_callback(
+                lagSource,
+                [] (gpointer userData) -> gboolean {
+                    Shard* shard = static_cast<Shard*>(userData);
+                    const gint64 now = g_get_monotonic_time();
+                    if(shard->lastSampleTime) {
+                        shard->lag =
+                            std::max<gint64>(now - shard->lastSampleTime - LagSampleInterval * 1000, 0);
+                    }
+                    shard->lastSampleTime = now;
+                    return G_SOURCE_CONTINUE;
+                },
+                shard,
+                nullptr);
+            g_source_attach(lagSource, shard->context);
+            g_source_unref(lagSource);
+
+            GMainLoop* loop = g_main_loop_new(shard->context, FALSE);
+            g_main_loop_run(loop);
+        }).detach();
+    }
+}
+
+GMainContext* GstSourceShards::Assign() noexcept
+{
+    Private& instance = Instance();
+
+    if(instance.shards.empty())
+        return nullptr;
+
+    const unsigned index = instance.next++ % instance.shards.size();
+
+    return g_main_context_ref(instance.shards[index]->context);
+}
+
+std::chrono::milliseconds GstSourceShards::maxLag() noexcept
+{
+    Private& instance = Instance();
+
+    gint64 maxLag = 0;
+    for(const std::unique_ptr<Shard>& shard: instance.shards)
+        maxLag = std::max<gint64>(maxLag, shard->lag);
+
+    return std::chrono::milliseconds(maxLag / 1000);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+
+#include <glib.h>
+
+
+// Optional set of worker threads, each running own GMainContext.
+// Every source is bound to one of them, so bus messages, timers
+// and peer signaling of different sources are handled in parallel.
+// Without Init() all sources stay on default main context
+class GstSourceShards
+{
+public:
+    // should be called once, before any source is created
+    static void Init(unsigned count) noexcept;
+
+    // thread safe
+    // returns referenced context for new source, or nullptr for default main context
+    static GMainContext* Assign() noexcept;
+
+    // thread safe
+    // worst dispatch delay of shard main loops measured recently
+    static std::chrono::milliseconds maxLag() noexcept;
+
+private:
+    struct Private;
+    static Private& Instance() noexcept;
+};
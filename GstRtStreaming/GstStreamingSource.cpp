@@ -1,6 +1,11 @@
 #include "GstStreamingSource.h"
 
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <vector>
 
 #include <gst/gst.h>
 #include <gst/pbutils/pbutils.h>
@@ -9,8 +14,95 @@
 #include <CxxPtr/GlibPtr.h>
 
 #include "GstWebRTCPeer2.h"
+#include "GstAdmissionController.h"
+#include "GstSourceShards.h"
+#include "GstPeerEventChannel.h"
+#include "GstThreadSafePeer.h"
+#include "RtpSlabAllocator.h"
 
 
+namespace {
+
+enum {
+    WARM_UP_RETRY_INTERVAL = 5, // seconds
+};
+
+struct WarmStandbyCandidate
+{
+    GstStreamingSource* source;
+    uint64_t sourceId;
+    GMainContext* context;
+    int priority;
+    bool warm; // as decided by last rebalance
+};
+
+// candidates can live on different shards
+std::mutex WarmStandbyMutex;
+unsigned WarmStandbyBudget = std::numeric_limits<unsigned>::max();
+std::vector<WarmStandbyCandidate> WarmStandbyCandidates;
+
+std::atomic<uint64_t> NextSourceId { 0 };
+
+// elements feeding given sink pad, directly or through other elements
+void CollectUpstreamElements(GstPad* sinkPad, std::vector<GstElementPtr>* elements)
+{
+    GstPadPtr peerPadPtr(gst_pad_get_peer(sinkPad));
+    if(!peerPadPtr)
+        return;
+
+    GstElementPtr elementPtr(gst_pad_get_parent_element(peerPadPtr.get()));
+    if(!elementPtr)
+        return;
+
+    GstElement* element = elementPtr.get();
+    if(std::find(elements->begin(), elements->end(), elementPtr) != elements->end())
+        return;
+
+    elements->emplace_back(std::move(elementPtr));
+
+    GstIterator* it = gst_element_iterate_sink_pads(element);
+    GValue value = G_VALUE_INIT;
+    while(gst_iterator_next(it, &value) == GST_ITERATOR_OK) {
+        GstPad* pad = static_cast<GstPad*>(g_value_get_object(&value));
+        CollectUpstreamElements(pad, elements);
+        g_value_reset(&value);
+    }
+    gst_iterator_free(it);
+}
+
+// should be called with WarmStandbyMutex locked
+WarmStandbyCandidate* FindWarmStandbyCandidate(const GstStreamingSource* source, uint64_t sourceId)
+{
+    for(WarmStandbyCandidate& candidate: WarmStandbyCandidates) {
+        if(candidate.source == source && candidate.sourceId == sourceId)
+            return &candidate;
+    }
+
+    return nullptr;
+}
+
+// should be called with WarmStandbyMutex locked
+void RemoveWarmStandbyCandidate(const GstStreamingSource* source, uint64_t sourceId)
+{
+    WarmStandbyCandidates.erase(
+        std::remove_if(
+            WarmStandbyCandidates.begin(),
+            WarmStandbyCandidates.end(),
+            [source, sourceId] (const WarmStandbyCandidate& candidate) {
+                return candidate.source == source && candidate.sourceId == sourceId;
+            }),
+        WarmStandbyCandidates.end());
+}
+
+GQuark TeePadsChangePendingQuark()
+{
+    static const GQuark quark =
+        g_quark_from_static_string("rtstreaming-tee-pads-change-pending");
+    return quark;
+}
+
+}
+
 void GstStreamingSource::PostLog(
     GstElement* element,
     spdlog::level::level_enum level,
@@ -34,11 +126,57 @@ void GstStreamingSource::PostLog(
     gst_bus_post(bus, message);
 }
 
+GstStreamingSource::GstStreamingSource() noexcept :
+    _id(++NextSourceId),
+    _context(GstSourceShards::Assign())
+{
+    static const gboolean fanOutRegistered = fan_out_register();
+    g_assert(fanOutRegistered);
+}
+
 GstStreamingSource::~GstStreamingSource()
 {
+    dropParkedPeers();
+
     assert(_peers.empty());
 
+    if(_warmStandbyRequested) {
+        {
+            std::lock_guard<std::mutex> lock(WarmStandbyMutex);
+            RemoveWarmStandbyCandidate(this, _id);
+        }
+        _warmStandbyRequested = false;
+        _warm = false;
+        RebalanceWarmStandby();
+    }
+
+    removeSource(&_warmUpRetryId);
+
     GstStreamingSource::cleanup();
+
+    if(_context)
+        g_main_context_unref(_context);
+}
+
+guint GstStreamingSource::attachSource(GSource* source, GSourceFunc callback) noexcept
+{
+    g_source_set_callback(source, callback, this, nullptr);
+    const guint sourceId = g_source_attach(source, _context);
+    g_source_unref(source);
+
+    return sourceId;
+}
+
+void GstStreamingSource::removeSource(guint* sourceId) noexcept
+{
+    if(!*sourceId)
+        return;
+
+    // g_source_remove() works with default main context only
+    if(GSource* source = g_main_context_find_source_by_id(_context, *sourceId))
+        g_source_destroy(source);
+
+    *sourceId = 0;
 }
 
 void GstStreamingSource::setState(GstState state) noexcept
@@ -94,15 +232,39 @@ gboolean GstStreamingSource::onBusMessage(GstMessage* message) noexcept
 
             gst_message_parse_error(message, &error, &debug);
 
+            MessageProxyPtr peerPtr = GstWebRTCPeer2::PeerMessageProxy(GST_MESSAGE_SRC(message));
+            MessageProxy* peer = peerPtr.get();
+            if(peer) {
+                log()->warn("Peer error: {}", error->message);
+            }
+
             g_free(debug);
             g_error_free(error);
 
+            if(peer) {
+                // error inside peer's branch doesn't affect source and other peers
+                if(_peers.find(peer) != _peers.end())
+                    g_signal_emit_by_name(peer, "eos", TRUE);
+                break;
+            }
+
             onEos(true);
             break;
         }
         case GST_MESSAGE_LATENCY:
-            if(const GstElement* pipeline = this->pipeline()) {
-                gst_bin_recalculate_latency(GST_BIN(pipeline));
+            ++_latencyStats.latencyMessages;
+            if(!_recalculateLatencyId) {
+                auto onRecalculateLatency =
+                    + [] (gpointer userData) -> gboolean {
+                        GstStreamingSource* self = static_cast<GstStreamingSource*>(userData);
+                        self->_recalculateLatencyId = 0;
+                        self->recalculateLatency();
+                        return G_SOURCE_REMOVE;
+                    };
+                // low priority lets already queued bus messages go first
+                GSource* idleSource = g_idle_source_new();
+                g_source_set_priority(idleSource, G_PRIORITY_DEFAULT_IDLE);
+                _recalculateLatencyId = attachSource(idleSource, onRecalculateLatency);
             }
             break;
         case GST_MESSAGE_APPLICATION: {
@@ -112,6 +274,7 @@ gboolean GstStreamingSource::onBusMessage(GstMessage* message) noexcept
             if(!structure)
                 break;
 
+            // peers of subclasses could still use bus to deliver their messages
             if(gst_structure_has_field(structure, "target")) {
                 MessageProxy* target = nullptr;
                 if(gst_structure_get(structure, "target", MESSAGE_PROXY_TYPE, &target, nullptr)) {
@@ -123,10 +286,8 @@ gboolean GstStreamingSource::onBusMessage(GstMessage* message) noexcept
 
             if(gst_message_has_name(message, "tee"))
                 onTeeAvailable(GST_ELEMENT(GST_MESSAGE_SRC(message)));
-            else if(gst_message_has_name(message, "tee-pad-added"))
-                onTeePadAdded();
-            else if(gst_message_has_name(message, "tee-pad-removed"))
-                onTeePadRemoved();
+            else if(gst_message_has_name(message, "tee-pads-changed"))
+                onTeePadsChanged(GST_ELEMENT(GST_MESSAGE_SRC(message)));
             else if(gst_message_has_name(message, "eos")) {
                 gboolean error = FALSE;
                 gst_structure_get_boolean(structure, "error", &error);
@@ -149,6 +310,23 @@ gboolean GstStreamingSource::onBusMessage(GstMessage* message) noexcept
     return TRUE;
 }
 
+void GstStreamingSource::recalculateLatency() noexcept
+{
+    GstElement* pipeline = this->pipeline();
+    if(!pipeline)
+        return;
+
+    using namespace std::chrono;
+
+    const steady_clock::time_point start = steady_clock::now();
+
+    gst_bin_recalculate_latency(GST_BIN(pipeline));
+
+    ++_latencyStats.recalculations;
+    _latencyStats.totalRecalculationTime +=
+        duration_cast<microseconds>(steady_clock::now() - start);
+}
+
 void GstStreamingSource::onEos(bool error) noexcept
 {
     _waitingPeers.clear();
@@ -160,6 +338,9 @@ void GstStreamingSource::onEos(bool error) noexcept
     }
 
     cleanup();
+
+    if(_warm)
+        scheduleWarmUpRetry();
 }
 
 void GstStreamingSource::setPipeline(GstElementPtr&& pipelinePtr) noexcept
@@ -179,7 +360,14 @@ void GstStreamingSource::setPipeline(GstElementPtr&& pipelinePtr) noexcept
             return self->onBusMessage(message);
         };
     GstBusPtr busPtr(gst_pipeline_get_bus(GST_PIPELINE(pipeline)));
-    gst_bus_add_watch(busPtr.get(), onBusMessageCallback, this);
+    // bus messages are dispatched on context of the source
+    _busWatchSource = gst_bus_create_watch(busPtr.get());
+    g_source_set_callback(
+        _busWatchSource,
+        reinterpret_cast<GSourceFunc>(onBusMessageCallback),
+        this,
+        nullptr);
+    g_source_attach(_busWatchSource, _context);
 }
 
 GstElement* GstStreamingSource::pipeline() const noexcept
@@ -205,50 +393,143 @@ bool GstStreamingSource::hasPeers() const noexcept
     return peerCount() > 0;
 }
 
+unsigned GstStreamingSource::activePeerCount() const noexcept
+{
+    GstElement* tee = this->tee();
+    if(!tee)
+        return 0;
+
+    gint activeTeeSrcPadsCount = 0;
+    g_object_get(G_OBJECT(tee), "num-active-src-pads", &activeTeeSrcPadsCount, nullptr);
+
+    return activeTeeSrcPadsCount ? activeTeeSrcPadsCount - 1 : 0; // 1 - for linked fakesink
+}
+
 void GstStreamingSource::onTeeAvailable(GstElement* tee) noexcept
 {
     GstElementPtr teePipelinePtr(GST_ELEMENT(gst_object_get_parent(GST_OBJECT(tee))));
 
     if(teePipelinePtr == _pipelinePtr) { // однако за время пути, собачка могла подрасти...
         _teePtr.reset(GST_ELEMENT_CAST(gst_object_ref(tee)));
-        for(MessageProxy* proxy: _waitingPeers) {
-            g_signal_emit_by_name(proxy, "tee", tee);
-        }
-        _waitingPeers.clear();
+        attachWaitingPeers();
     }
 }
 
-void GstStreamingSource::onTeePadAdded() noexcept
+void GstStreamingSource::attachWaitingPeers() noexcept
 {
-    if(hasPeers())
-        onPeerAttached();
+    GstElement* tee = this->tee();
+    if(!tee)
+        return;
+
+    if(_waitingPeers.empty())
+        return;
+
+    using namespace std::chrono;
+
+    const steady_clock::time_point attachStart = steady_clock::now();
+
+    // peer can be destroyed from "tee" handler
+    const std::set<MessageProxy*> tmpWaitingPeers = std::move(_waitingPeers);
+    _waitingPeers.clear();
+    for(MessageProxy* proxy: tmpWaitingPeers) {
+        g_signal_emit_by_name(proxy, "tee", tee);
+    }
+
+    const microseconds attachTime = duration_cast<microseconds>(steady_clock::now() - attachStart);
+
+    _attachStats.attachedPeers += tmpWaitingPeers.size();
+    _attachStats.batches += 1;
+    _attachStats.maxBatchSize = std::max<unsigned>(_attachStats.maxBatchSize, tmpWaitingPeers.size());
+    _attachStats.totalAttachTime += attachTime;
+    _attachStats.maxBatchAttachTime = std::max(_attachStats.maxBatchAttachTime, attachTime);
 }
 
-void GstStreamingSource::onTeePadRemoved() noexcept
+void GstStreamingSource::onTeePadsChanged(GstElement* tee) noexcept
 {
-    if(!hasPeers()) // only fakesink is linked
+    // any change after that point will post new message
+    if(std::atomic<bool>* pending =
+        static_cast<std::atomic<bool>*>(g_object_get_qdata(G_OBJECT(tee), TeePadsChangePendingQuark())))
+    {
+        pending->store(false);
+    }
+
+    if(tee != this->tee())
+        return;
+
+    const bool hasActivePeers = activePeerCount() > 0;
+    const bool hasPeers = this->hasPeers();
+
+    if(hasActivePeers || !hasPeers)
+        resumeTee();
+
+    if(hasActivePeers)
+        onPeerAttached();
+    else if(hasPeers)
+        onLastPeerPaused();
+    else // only fakesink is linked
         onLastPeerDetached();
 }
 
-// will be called from streaming thread
-void GstStreamingSource::postTeeAvailable(GstElement* tee) noexcept
+void GstStreamingSource::pauseTee() noexcept
 {
-    GstBusPtr busPtr(gst_element_get_bus(tee));
-    GstBus* bus = busPtr.get();
-    if(!bus)
+    GstElement* tee = this->tee();
+    if(!tee || _teePaused)
         return;
 
-    GstStructure* structure =
-        gst_structure_new_empty("tee");
+    // webrtcbins stay in PLAYING and keep ICE/DTLS sessions alive,
+    // but get nothing from fan out even if source doesn't stop immediately
+    g_object_set(tee, "drop", TRUE, nullptr);
+    _teePaused = true;
+
+    GstPadPtr teeSinkPadPtr(gst_element_get_static_pad(tee, "sink"));
+    GstPad* teeSinkPad = teeSinkPadPtr.get();
+
+    gboolean live = FALSE;
+    GstQuery* query = gst_query_new_latency();
+    if(gst_pad_peer_query(teeSinkPad, query))
+        gst_query_parse_latency(query, &live, nullptr, nullptr);
+    gst_query_unref(query);
+
+    if(live) {
+        // blocked pad wouldn't stop live source (rtspsrc etc.), but PAUSED state does
+        CollectUpstreamElements(teeSinkPad, &_pausedUpstreamElements);
+        for(const GstElementPtr& elementPtr: _pausedUpstreamElements)
+            gst_element_set_state(elementPtr.get(), GST_STATE_PAUSED);
+    } else {
+        // non live source (encoder etc.) stalls on blocked pad
+        _teeBlockProbeId = gst_pad_add_probe(
+            teeSinkPad,
+            GstPadProbeType(GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+            [] (GstPad*, GstPadProbeInfo*, gpointer) -> GstPadProbeReturn {
+                return GST_PAD_PROBE_OK;
+            },
+            nullptr,
+            nullptr);
+    }
+}
 
-    GstMessage* message =
-        gst_message_new_application(GST_OBJECT(tee), structure);
+void GstStreamingSource::resumeTee() noexcept
+{
+    GstElement* tee = this->tee();
+    if(!tee || !_teePaused)
+        return;
 
-    gst_bus_post(bus, message);
+    for(const GstElementPtr& elementPtr: _pausedUpstreamElements)
+        gst_element_sync_state_with_parent(elementPtr.get());
+    _pausedUpstreamElements.clear();
+
+    if(_teeBlockProbeId) {
+        GstPadPtr teeSinkPadPtr(gst_element_get_static_pad(tee, "sink"));
+        gst_pad_remove_probe(teeSinkPadPtr.get(), _teeBlockProbeId);
+        _teeBlockProbeId = 0;
+    }
+
+    g_object_set(tee, "drop", FALSE, nullptr);
+    _teePaused = false;
 }
 
 // will be called from streaming thread
-void GstStreamingSource::postTeePadAdded(GstElement* tee) noexcept
+void GstStreamingSource::postTeeAvailable(GstElement* tee) noexcept
 {
     GstBusPtr busPtr(gst_element_get_bus(tee));
     GstBus* bus = busPtr.get();
@@ -256,7 +537,7 @@ void GstStreamingSource::postTeePadAdded(GstElement* tee) noexcept
         return;
 
     GstStructure* structure =
-        gst_structure_new_empty("tee-pad-added");
+        gst_structure_new_empty("tee");
 
     GstMessage* message =
         gst_message_new_application(GST_OBJECT(tee), structure);
@@ -265,15 +546,24 @@ void GstStreamingSource::postTeePadAdded(GstElement* tee) noexcept
 }
 
 // will be called from streaming thread
-void GstStreamingSource::postTeePadRemoved(GstElement* tee) noexcept
+// bursts of pad additions/removals are coalesced into single message
+void GstStreamingSource::postTeePadsChanged(GstElement* tee) noexcept
 {
+    std::atomic<bool>* pending =
+        static_cast<std::atomic<bool>*>(g_object_get_qdata(G_OBJECT(tee), TeePadsChangePendingQuark()));
+    if(pending && pending->exchange(true))
+        return;
+
     GstBusPtr busPtr(gst_element_get_bus(tee));
     GstBus* bus = busPtr.get();
-    if(!bus)
+    if(!bus) {
+        if(pending)
+            pending->store(false);
         return;
+    }
 
     GstStructure* structure =
-        gst_structure_new_empty("tee-pad-removed");
+        gst_structure_new_empty("tee-pads-changed");
 
     GstMessage* message =
         gst_message_new_application(GST_OBJECT(tee), structure);
@@ -290,9 +580,15 @@ void GstStreamingSource::setTee(GstElement* tee) noexcept
 
     GstElement* pipeline = this->pipeline();
 
+    g_object_set_qdata_full(
+        G_OBJECT(tee),
+        TeePadsChangePendingQuark(),
+        new std::atomic<bool>(false),
+        [] (gpointer data) { delete static_cast<std::atomic<bool>*>(data); });
+
     auto onPadAddedCallback =
         + [] (GstElement* tee, GstPad*, gpointer*) {
-            postTeePadAdded(tee);
+            postTeePadsChanged(tee);
         };
     g_signal_connect(
         tee,
@@ -302,7 +598,7 @@ void GstStreamingSource::setTee(GstElement* tee) noexcept
 
     auto onPadRemovedCallback =
         + [] (GstElement* tee, GstPad* pad, gpointer*) {
-            postTeePadRemoved(tee);
+            postTeePadsChanged(tee);
         };
     g_signal_connect(
         tee,
@@ -310,6 +606,16 @@ void GstStreamingSource::setTee(GstElement* tee) noexcept
         G_CALLBACK(onPadRemovedCallback),
         pipeline);
 
+    auto onActivePadsChangedCallback =
+        + [] (GstElement* tee, GParamSpec*, gpointer*) {
+            postTeePadsChanged(tee);
+        };
+    g_signal_connect(
+        tee,
+        "notify::num-active-src-pads",
+        G_CALLBACK(onActivePadsChangedCallback),
+        pipeline);
+
     _fakeSinkPtr.reset(gst_element_factory_make("fakesink", nullptr));
     GstElement* fakeSink = _fakeSinkPtr.get();
     g_object_set(fakeSink, "sync", TRUE, NULL);
@@ -317,6 +623,13 @@ void GstStreamingSource::setTee(GstElement* tee) noexcept
     gst_bin_add(GST_BIN(pipeline), GST_ELEMENT(gst_object_ref(fakeSink)));
 
     GstPadPtr teePadPtr(gst_element_get_request_pad(tee, "src_%u"));
+    if(const guint64 gopCacheMaxBytes = _gopCacheMaxBytes)
+        g_object_set(tee, "gop-cache-max-bytes", gopCacheMaxBytes, nullptr);
+    if(_frameLists)
+        g_object_set(tee, "frame-lists", TRUE, nullptr);
+
+    // sync fakesink has to block streaming thread to keep non live sources in real time
+    g_object_set(teePadPtr.get(), "direct", TRUE, nullptr);
     GstPadPtr fakeSinkPadPtr(gst_element_get_static_pad(fakeSink, "sink"));
     if(GST_PAD_LINK_OK != gst_pad_link(teePadPtr.get(), fakeSinkPadPtr.get())) {
         g_assert(false);
@@ -334,6 +647,89 @@ GstElement* GstStreamingSource::tee() const noexcept
     return _teePtr.get();
 }
 
+GstStreamingSource::StreamStats GstStreamingSource::streamStats() const noexcept
+{
+    StreamStats stats;
+
+    GstElement* tee = this->tee();
+    if(!tee)
+        return stats;
+
+    GstStructure* structure = nullptr;
+    g_object_get(tee, "stats", &structure, nullptr);
+    if(!structure)
+        return stats;
+
+    guint64 jitter = 0;
+    gint64 lastBufferTime = 0;
+    gst_structure_get(
+        structure,
+        "bytes", G_TYPE_UINT64, &stats.bytes,
+        "packets", G_TYPE_UINT64, &stats.packets,
+        "frames", G_TYPE_UINT64, &stats.frames,
+        "key-frames", G_TYPE_UINT64, &stats.keyFrames,
+        "gop-length", G_TYPE_UINT, &stats.gopLength,
+        "jitter", G_TYPE_UINT64, &jitter,
+        "last-buffer-time", G_TYPE_INT64, &lastBufferTime,
+        "bitrate", G_TYPE_UINT64, &stats.bitrate,
+        "packet-rate", G_TYPE_UINT64, &stats.packetRate,
+        "frame-rate", G_TYPE_UINT64, &stats.frameRate,
+        nullptr);
+    gst_structure_free(structure);
+
+    stats.jitter = std::chrono::microseconds(jitter);
+    stats.lastBufferTime = lastBufferTime;
+
+    return stats;
+}
+
+void GstStreamingSource::setGopCacheMaxBytes(guint64 maxBytes) noexcept
+{
+    _gopCacheMaxBytes = maxBytes;
+
+    if(GstElement* tee = this->tee())
+        g_object_set(tee, "gop-cache-max-bytes", maxBytes, nullptr);
+}
+
+void GstStreamingSource::setFrameLists(bool frameLists) noexcept
+{
+    _frameLists = frameLists;
+
+    if(GstElement* tee = this->tee())
+        g_object_set(tee, "frame-lists", frameLists, nullptr);
+}
+
+void GstStreamingSource::UseSlabAllocator() noexcept
+{
+    static std::once_flag installed;
+    std::call_once(installed, [] () { rtp_slab_allocator_install(); });
+}
+
+GstStreamingSource::AllocatorStats GstStreamingSource::SlabAllocatorStats() noexcept
+{
+    RtpSlabAllocatorStats slabStats;
+    rtp_slab_allocator_get_stats(&slabStats);
+
+    AllocatorStats stats;
+    stats.allocations = slabStats.allocations;
+    stats.cacheHits = slabStats.cacheHits;
+    stats.fallbacks = slabStats.fallbacks;
+    stats.blocks = slabStats.blocks;
+    stats.blocksInUse = slabStats.blocksInUse;
+
+    return stats;
+}
+
+void GstStreamingSource::setAttachBatchWindow(std::chrono::milliseconds window) noexcept
+{
+    _attachBatchWindow = window;
+}
+
+void GstStreamingSource::setThreadSafePeers(bool threadSafe) noexcept
+{
+    _threadSafePeers = threadSafe;
+}
+
 void GstStreamingSource::onPeerAttached() noexcept
 {
     GstElement* pipeline = this->pipeline();
@@ -347,10 +743,53 @@ void GstStreamingSource::onPeerAttached() noexcept
         play();
 }
 
+void GstStreamingSource::onLastPeerPaused() noexcept
+{
+    if(!_warm)
+        pauseTee();
+}
+
+void GstStreamingSource::setLingerTimeout(std::chrono::milliseconds timeout) noexcept
+{
+    _lingerTimeout = timeout;
+}
+
 void GstStreamingSource::onLastPeerDetached() noexcept
 {
-    if(_peers.empty()) // some new peer can appear while message traveled between threads
+    if(!_peers.empty()) // some new peer can appear while message traveled between threads
+        return;
+
+    if(_warm)
+        return;
+
+    if(_lingerTimeout.count() == 0) {
         cleanup();
+        return;
+    }
+
+    if(_lingerTimeoutId)
+        return;
+
+    auto onLingerTimeoutCallback =
+        + [] (gpointer userData) -> gboolean {
+            GstStreamingSource* self = static_cast<GstStreamingSource*>(userData);
+            self->_lingerTimeoutId = 0;
+            self->onLingerTimeout();
+            return G_SOURCE_REMOVE;
+        };
+    _lingerTimeoutId = attachSource(
+        g_timeout_source_new(_lingerTimeout.count()),
+        onLingerTimeoutCallback);
+}
+
+void GstStreamingSource::onLingerTimeout() noexcept
+{
+    if(!_peers.empty() || _warm)
+        return;
+
+    ++_lingerStats.misses;
+
+    cleanup();
 }
 
 void GstStreamingSource::onPeerDestroyed(MessageProxy* messageProxy) noexcept
@@ -365,11 +804,269 @@ void GstStreamingSource::onPeerDestroyed(MessageProxy* messageProxy) noexcept
         onLastPeerDestroyed();
 }
 
-std::unique_ptr<WebRTCPeer> GstStreamingSource::createPeer() noexcept
+void GstStreamingSource::SetWarmStandbyBudget(unsigned budget) noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(WarmStandbyMutex);
+        WarmStandbyBudget = budget;
+    }
+
+    RebalanceWarmStandby();
+}
+
+void GstStreamingSource::setWarmStandby(bool enable, int priority) noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(WarmStandbyMutex);
+
+        if(_warmStandbyRequested)
+            RemoveWarmStandbyCandidate(this, _id);
+
+        if(enable)
+            WarmStandbyCandidates.push_back(WarmStandbyCandidate { this, _id, _context, priority, _warm });
+    }
+
+    _warmStandbyRequested = enable;
+
+    if(!enable)
+        coolDown();
+
+    RebalanceWarmStandby();
+}
+
+void GstStreamingSource::RebalanceWarmStandby() noexcept
+{
+    struct Invocation {
+        GstStreamingSource* source;
+        uint64_t sourceId;
+    };
+
+    // candidates are warmed up and cooled down on their own contexts
+    std::vector<std::pair<GMainContext*, Invocation>> coolDowns;
+    std::vector<std::pair<GMainContext*, Invocation>> warmUps;
+    {
+        std::lock_guard<std::mutex> lock(WarmStandbyMutex);
+
+        std::vector<WarmStandbyCandidate*> candidates;
+        for(WarmStandbyCandidate& candidate: WarmStandbyCandidates)
+            candidates.push_back(&candidate);
+
+        std::stable_sort(
+            candidates.begin(),
+            candidates.end(),
+            [] (const WarmStandbyCandidate* l, const WarmStandbyCandidate* r) {
+                return l->priority > r->priority;
+            });
+
+        for(size_t i = 0; i < candidates.size(); ++i) {
+            WarmStandbyCandidate& candidate = *candidates[i];
+            const bool warm = i < WarmStandbyBudget;
+            if(candidate.warm == warm)
+                continue;
+
+            candidate.warm = warm;
+            (warm ? warmUps : coolDowns).emplace_back(
+                candidate.context,
+                Invocation { candidate.source, candidate.sourceId });
+        }
+    }
+
+    auto onInvoke =
+        + [] (gpointer userData) -> gboolean {
+            const Invocation* invocation = static_cast<Invocation*>(userData);
+
+            // source is destroyed on the same thread,
+            // so if it's still registered it's alive
+            {
+                std::lock_guard<std::mutex> lock(WarmStandbyMutex);
+                if(!FindWarmStandbyCandidate(invocation->source, invocation->sourceId))
+                    return G_SOURCE_REMOVE;
+            }
+
+            invocation->source->applyWarmStandby();
+
+            return G_SOURCE_REMOVE;
+        };
+
+    // cool down first to not exceed budget even temporary
+    for(auto* invocations: { &coolDowns, &warmUps }) {
+        for(const auto& pair: *invocations) {
+            g_main_context_invoke_full(
+                pair.first,
+                G_PRIORITY_DEFAULT,
+                onInvoke,
+                new Invocation(pair.second),
+                [] (gpointer userData) { delete static_cast<Invocation*>(userData); });
+        }
+    }
+}
+
+void GstStreamingSource::applyWarmStandby() noexcept
+{
+    bool warm = false;
+    {
+        std::lock_guard<std::mutex> lock(WarmStandbyMutex);
+        if(const WarmStandbyCandidate* candidate = FindWarmStandbyCandidate(this, _id))
+            warm = candidate->warm;
+    }
+
+    if(warm)
+        warmUp();
+    else
+        coolDown();
+}
+
+void GstStreamingSource::warmUp() noexcept
+{
+    if(_warm)
+        return;
+
+    _warm = true;
+
+    if(!pipeline() && !prepare()) {
+        log()->error("Failed to warm up source");
+        scheduleWarmUpRetry();
+        return;
+    }
+
+    play();
+}
+
+void GstStreamingSource::coolDown() noexcept
 {
-    if(!prepare())
+    removeSource(&_warmUpRetryId);
+
+    if(!_warm)
+        return;
+
+    _warm = false;
+
+    if(_peers.empty())
+        cleanup();
+}
+
+void GstStreamingSource::scheduleWarmUpRetry() noexcept
+{
+    if(_warmUpRetryId)
+        return;
+
+    auto onWarmUpRetry =
+        + [] (gpointer userData) -> gboolean {
+            GstStreamingSource* self = static_cast<GstStreamingSource*>(userData);
+            self->_warmUpRetryId = 0;
+            if(self->_warm && !self->pipeline()) {
+                self->_warm = false;
+                self->warmUp();
+            }
+            return G_SOURCE_REMOVE;
+        };
+    _warmUpRetryId = attachSource(
+        g_timeout_source_new_seconds(WARM_UP_RETRY_INTERVAL),
+        onWarmUpRetry);
+}
+
+void GstStreamingSource::setReconnectGracePeriod(std::chrono::milliseconds period) noexcept
+{
+    _reconnectGracePeriod = period;
+}
+
+void GstStreamingSource::parkPeer(
+    const std::string& sessionId,
+    std::unique_ptr<WebRTCPeer>&& peerPtr) noexcept
+{
+    if(!peerPtr || _reconnectGracePeriod.count() <= 0)
+        return; // peer is destroyed right away
+
+    peerPtr->detachClient();
+    peerPtr->pause();
+
+    const gint64 deadline =
+        g_get_monotonic_time() +
+        std::chrono::duration_cast<std::chrono::microseconds>(_reconnectGracePeriod).count();
+
+    // previously parked peer with the same id (if any) is destroyed
+    _parkedPeers[sessionId] = ParkedPeer { std::move(peerPtr), deadline };
+
+    if(!_parkedPeersTimeoutId) {
+        auto onParkedPeersTimeout =
+            + [] (gpointer userData) -> gboolean {
+                GstStreamingSource* self = static_cast<GstStreamingSource*>(userData);
+                self->expireParkedPeers();
+                if(!self->_parkedPeers.empty())
+                    return G_SOURCE_CONTINUE;
+
+                self->_parkedPeersTimeoutId = 0;
+                return G_SOURCE_REMOVE;
+            };
+        _parkedPeersTimeoutId = attachSource(g_timeout_source_new_seconds(1), onParkedPeersTimeout);
+    }
+}
+
+std::unique_ptr<WebRTCPeer> GstStreamingSource::unparkPeer(const std::string& sessionId) noexcept
+{
+    expireParkedPeers();
+
+    const auto it = _parkedPeers.find(sessionId);
+    if(it == _parkedPeers.end())
         return nullptr;
 
+    std::unique_ptr<WebRTCPeer> peerPtr = std::move(it->second.peer);
+    _parkedPeers.erase(it);
+
+    peerPtr->resume();
+
+    return peerPtr;
+}
+
+void GstStreamingSource::expireParkedPeers() noexcept
+{
+    const gint64 now = g_get_monotonic_time();
+
+    std::vector<std::unique_ptr<WebRTCPeer>> expired;
+    for(auto it = _parkedPeers.begin(); it != _parkedPeers.end();) {
+        if(it->second.deadline <= now) {
+            expired.emplace_back(std::move(it->second.peer));
+            it = _parkedPeers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // peers are destroyed only after registry is consistent again
+    expired.clear();
+}
+
+void GstStreamingSource::dropParkedPeers() noexcept
+{
+    removeSource(&_parkedPeersTimeoutId);
+
+    std::map<std::string, ParkedPeer> parkedPeers;
+    parkedPeers.swap(_parkedPeers);
+    parkedPeers.clear();
+}
+
+std::unique_ptr<WebRTCPeer> GstStreamingSource::createPeer(
+    GstRtStreaming::PeerPriority priority,
+    GstRtStreaming::AdmissionResult* result) noexcept
+{
+    const GstRtStreaming::AdmissionResult admission = GstAdmissionController::Admit(priority);
+    if(result)
+        *result = admission;
+    if(admission != GstRtStreaming::AdmissionResult::Admitted)
+        return nullptr;
+
+    if(_lingerTimeoutId) {
+        // pipeline is still alive, so peer will be attached right away
+        removeSource(&_lingerTimeoutId);
+        ++_lingerStats.hits;
+    }
+
+    if(!prepare()) {
+        if(result)
+            *result = GstRtStreaming::AdmissionResult::SourceFailed;
+        return nullptr;
+    }
+
     MessageProxyPtr messageProxyPtr(message_proxy_new());
     MessageProxy* messageProxy = messageProxyPtr.get();
 
@@ -382,43 +1079,46 @@ std::unique_ptr<WebRTCPeer> GstStreamingSource::createPeer() noexcept
 
     _peers.insert(messageProxy);
 
+    // peer's signaling events are dispatched on context of the source
+    GstPeerEventChannel::Bind(messageProxy, _context);
+
     std::unique_ptr<GstWebRTCPeer2> peerPtr =
-        std::make_unique<GstWebRTCPeer2>(std::move(messageProxyPtr));
-    if(tee()) {
+        std::make_unique<GstWebRTCPeer2>(std::move(messageProxyPtr), priority);
+    if(tee() && _attachBatchWindow.count() == 0) {
         g_signal_emit_by_name(messageProxy, "tee", tee());
     } else {
         _waitingPeers.emplace(messageProxy);
+
+        if(tee() && !_attachBatchTimeoutId) {
+            auto onAttachBatchTimeout =
+                + [] (gpointer userData) -> gboolean {
+                    GstStreamingSource* self = static_cast<GstStreamingSource*>(userData);
+                    self->_attachBatchTimeoutId = 0;
+                    self->attachWaitingPeers();
+                    return G_SOURCE_REMOVE;
+                };
+            _attachBatchTimeoutId = attachSource(
+                g_timeout_source_new(_attachBatchWindow.count()),
+                onAttachBatchTimeout);
+        }
     }
 
+    if(_threadSafePeers)
+        return std::make_unique<GstThreadSafePeer>(_context, messageProxy, std::move(peerPtr));
+
     return std::move(peerPtr);
 }
 
 void GstStreamingSource::destroyPeer(MessageProxy* messageProxy) noexcept
 {
-    GstBusPtr busPtr(gst_element_get_bus(pipeline()));
-    GstBus* bus = busPtr.get();
-    if(!bus)
-        return;
-
-    GstStructure* structure =
-        gst_structure_new(
-            "eos",
-            "error", G_TYPE_BOOLEAN, true,
-            nullptr);
-
-    gst_structure_set(
-        structure,
-        "target", MESSAGE_PROXY_TYPE, messageProxy,
-        NULL);
-
-    GstMessage* message =
-        gst_message_new_application(GST_OBJECT(pipeline()), structure);
-
-    gst_bus_post(bus, message);
+    GstPeerEventChannel::PostEos(messageProxy, true);
 }
 
 void GstStreamingSource::destroyPeers() noexcept
 {
+    // nobody is going to return to failed stream
+    dropParkedPeers();
+
     for(MessageProxy* messageProxy: _peers) {
         destroyPeer(messageProxy);
     }
@@ -432,19 +1132,34 @@ GstElement* GstStreamingSource::releasePipeline() noexcept
         return nullptr;
     }
 
+    // paused upstream will be stopped with the whole pipeline
+    _pausedUpstreamElements.clear();
+    resumeTee();
+
     _teePtr.reset();
     _fakeSinkPtr.reset();
 
-    GstBusPtr busPtr(gst_pipeline_get_bus(GST_PIPELINE(pipeline)));
-    gst_bus_remove_watch(busPtr.get());
+    removeSource(&_recalculateLatencyId);
+
+    if(_busWatchSource) {
+        g_source_destroy(_busWatchSource);
+        g_source_unref(_busWatchSource);
+        _busWatchSource = nullptr;
+    }
 
     return _pipelinePtr.release();
 }
 
 void GstStreamingSource::cleanup() noexcept
 {
+    // parked peers are owned by source
+    dropParkedPeers();
+
     assert(_peers.empty() && _waitingPeers.empty());
 
+    removeSource(&_attachBatchTimeoutId);
+    removeSource(&_lingerTimeoutId);
+
     GstElement* pipeline = _pipelinePtr.get();
     if(!pipeline) {
         assert(!_teePtr && !_fakeSinkPtr);
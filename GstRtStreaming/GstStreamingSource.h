@@ -1,30 +1,148 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <atomic>
+#include <chrono>
 #include <set>
+#include <map>
 #include <unordered_set>
+#include <vector>
 
 #include "CxxPtr/GstPtr.h"
 
 #include "../WebRTCPeer.h"
 
+#include "Types.h"
 #include "Log.h"
 #include "MessageProxy.h"
+#include "FanOut.h"
 
 
+// Thread affinity: source is bound to context() (see GstSourceShards).
+// Its bus messages and timers are dispatched there, and so are callbacks of peers created by it.
+// Source and its peers should be created, used and destroyed only on thread running that context,
+// the only exceptions are static methods and methods explicitly marked as thread safe
 class GstStreamingSource
 {
 public:
+    struct LatencyStats {
+        uint64_t latencyMessages = 0;
+        uint64_t recalculations = 0;
+        std::chrono::microseconds totalRecalculationTime {};
+    };
+
+    struct AttachStats {
+        uint64_t attachedPeers = 0;
+        uint64_t batches = 0;
+        unsigned maxBatchSize = 0;
+        std::chrono::microseconds totalAttachTime {};
+        std::chrono::microseconds maxBatchAttachTime {};
+    };
+
+    struct LingerStats {
+        uint64_t hits = 0; // peer appeared while pipeline lingered
+        uint64_t misses = 0; // pipeline was destroyed after linger period
+    };
+
+    // stream going into tee, counted on streaming thread without locks
+    struct StreamStats {
+        uint64_t bytes = 0;
+        uint64_t packets = 0;
+        uint64_t frames = 0; // H264/H265/VP8 only
+        uint64_t keyFrames = 0;
+        unsigned gopLength = 0; // frames between last two key frames
+        std::chrono::microseconds jitter {}; // RFC 3550 interarrival jitter
+        int64_t lastBufferTime = 0; // g_get_monotonic_time() of last buffer, 0 if none
+        // averaged over last 5 seconds
+        uint64_t bitrate = 0; // bits per second
+        uint64_t packetRate = 0;
+        uint64_t frameRate = 0;
+    };
+
+    struct AllocatorStats {
+        uint64_t allocations = 0; // served from slabs
+        uint64_t cacheHits = 0; // served with reused block
+        uint64_t fallbacks = 0; // too big for slab, allocated by system memory allocator
+        uint64_t blocks = 0; // ever allocated, the rest are reused
+        uint64_t blocksInUse = 0;
+    };
+
     virtual ~GstStreamingSource();
 
-    std::unique_ptr<WebRTCPeer> createPeer() noexcept;
+    // thread safe
+    // context source is bound to, nullptr means default main context
+    GMainContext* context() const noexcept
+        { return _context; }
+
+    // under load peers are degraded starting from lowest priority ones (see GstLoadGovernor).
+    // returns nullptr if node is out of capacity (see GstAdmissionController)
+    // or source failed to prepare, reason is returned via AdmissionResult
+    std::unique_ptr<WebRTCPeer> createPeer(
+        GstRtStreaming::PeerPriority = GstRtStreaming::PeerPriority::Normal,
+        GstRtStreaming::AdmissionResult* = nullptr) noexcept;
     virtual std::unique_ptr<WebRTCPeer> createRecordPeer() noexcept { return nullptr; }
 
+    // peers created after that can be used and destroyed from any thread
+    // (see GstThreadSafePeer), createPeer() itself should still be called on context()
+    void setThreadSafePeers(bool) noexcept;
+
+    // new peers get buffers since last key frame right away,
+    // instead of waiting for next one (0 = disabled)
+    void setGopCacheMaxBytes(guint64) noexcept;
+
+    // packets of every frame go to peers as single buffer list,
+    // even if payloader pushes them one by one
+    void setFrameLists(bool) noexcept;
+
+    // should be called after gst_init() and before any source is created.
+    // Payloaders, and branches of peers as well, get packet sized memory
+    // from thread cached slabs instead of malloc (see RtpSlabAllocator).
+    // Affects every buffer allocated with default allocator in process
+    static void UseSlabAllocator() noexcept;
+    // thread safe
+    static AllocatorStats SlabAllocatorStats() noexcept;
+
+    // peers created within window are attached in one pass (0 = attach immediately).
+    // 5ms by default: it's well below time to negotiate, but coalesces join storms
+    void setAttachBatchWindow(std::chrono::milliseconds) noexcept;
+    const AttachStats& attachStats() const noexcept
+        { return _attachStats; }
+
+    const LatencyStats& latencyStats() const noexcept
+        { return _latencyStats; }
+
+    // snapshot, empty if pipeline is not running
+    StreamStats streamStats() const noexcept;
+
+    // pipeline is kept running for that period after last peer has gone (0 = destroy immediately)
+    void setLingerTimeout(std::chrono::milliseconds) noexcept;
+    const LingerStats& lingerStats() const noexcept
+        { return _lingerStats; }
+
+    // peer of disconnected client is paused and kept (with its branch) for that period,
+    // so returning client can take it back by session id (0 = peers are not kept)
+    void setReconnectGracePeriod(std::chrono::milliseconds) noexcept;
+    // takes ownership of peer previously created by this source
+    void parkPeer(const std::string& sessionId, std::unique_ptr<WebRTCPeer>&&) noexcept;
+    // returns resumed peer or nullptr if nothing was parked or grace period is over.
+    // WebRTCPeer::restartIce() should be called to reconnect it
+    std::unique_ptr<WebRTCPeer> unparkPeer(const std::string& sessionId) noexcept;
+
+    // thread safe
+    // max number of sources kept warm at the same time
+    static void SetWarmStandbyBudget(unsigned) noexcept;
+    // warm source builds and starts pipeline without any peer, so first peer gets stream instantly.
+    // sources with higher priority win if there are more candidates than budget allows
+    void setWarmStandby(bool enable, int priority = 0) noexcept;
+    bool isWarm() const noexcept
+        { return _warm; }
+
 protected:
     // thread safe
     static void PostLog(GstElement*, spdlog::level::level_enum, const std::string& message) noexcept;
 
-    GstStreamingSource() noexcept = default;
+    GstStreamingSource() noexcept;
     GstStreamingSource& operator= (GstStreamingSource&) = delete;
 
     void onEos(bool error) noexcept;
@@ -37,6 +155,7 @@ protected:
     void setPipeline(GstElementPtr&&) noexcept;
     GstElement* pipeline() const noexcept;
 
+    // expects FAN_OUT_FACTORY_NAME element
     void setTee(GstElement*) noexcept;
     GstElement* tee() const noexcept;
 
@@ -47,10 +166,14 @@ protected:
     virtual void onPrerolled() noexcept {}
     virtual void onPeerAttached() noexcept;
     virtual void onLastPeerDetached() noexcept;
+    // all attached peers are paused,
+    // by default upstream is paused (live source) or stalled on blocked tee till resume
+    virtual void onLastPeerPaused() noexcept;
     virtual void onLastPeerDestroyed() noexcept {}
 
     unsigned peerCount() const noexcept;
     bool hasPeers() const noexcept;
+    unsigned activePeerCount() const noexcept; // not paused peers
     void destroyPeers() noexcept;
 
 private:
@@ -58,14 +181,31 @@ private:
         { return _log; }
 
     gboolean onBusMessage(GstMessage*) noexcept;
+    void recalculateLatency() noexcept;
 
     static void postTeeAvailable(GstElement* tee) noexcept;
-    static void postTeePadAdded(GstElement* tee) noexcept;
-    static void postTeePadRemoved(GstElement* tee) noexcept;
+    static void postTeePadsChanged(GstElement* tee) noexcept;
 
     void onTeeAvailable(GstElement* tee) noexcept;
-    void onTeePadAdded() noexcept;
-    void onTeePadRemoved() noexcept;
+    void onTeePadsChanged(GstElement* tee) noexcept;
+
+    // source is attached to context() and owned by it, returns source id
+    guint attachSource(GSource*, GSourceFunc) noexcept;
+    void removeSource(guint* sourceId) noexcept;
+
+    void attachWaitingPeers() noexcept;
+    void onLingerTimeout() noexcept;
+    void expireParkedPeers() noexcept;
+    void dropParkedPeers() noexcept;
+
+    void pauseTee() noexcept;
+    void resumeTee() noexcept;
+
+    static void RebalanceWarmStandby() noexcept;
+    void applyWarmStandby() noexcept;
+    void warmUp() noexcept;
+    void coolDown() noexcept;
+    void scheduleWarmUpRetry() noexcept;
 
     void onPeerDestroyed(MessageProxy*) noexcept;
     void destroyPeer(MessageProxy*) noexcept;
@@ -73,12 +213,52 @@ private:
 private:
     const std::shared_ptr<spdlog::logger> _log = GstRtStreamingLog();
 
+    // unique, unlike address of source
+    const uint64_t _id;
+    GMainContext* const _context;
+    GSource* _busWatchSource = nullptr;
+
     GstElementPtr _pipelinePtr;
     GstElementPtr _teePtr;
     GstElementPtr _fakeSinkPtr;
 
     bool _prerolled = false;
 
+    std::atomic<guint64> _gopCacheMaxBytes { 0 };
+    std::atomic<bool> _frameLists { false };
+
+    std::chrono::milliseconds _attachBatchWindow { 5 };
+    guint _attachBatchTimeoutId = 0;
+    AttachStats _attachStats;
+
+    bool _threadSafePeers = false;
+
+    bool _teePaused = false;
+    // live source is paused, other ones are stalled on blocked tee
+    std::vector<GstElementPtr> _pausedUpstreamElements;
+    gulong _teeBlockProbeId = 0;
+
+    // latency messages of one main loop iteration are handled by single recalculation
+    guint _recalculateLatencyId = 0;
+    LatencyStats _latencyStats;
+
+    std::chrono::milliseconds _lingerTimeout {};
+    guint _lingerTimeoutId = 0;
+    LingerStats _lingerStats;
+
+    struct ParkedPeer {
+        std::unique_ptr<WebRTCPeer> peer;
+        gint64 deadline; // monotonic time
+    };
+    std::chrono::milliseconds _reconnectGracePeriod {};
+    std::map<std::string, ParkedPeer> _parkedPeers;
+    guint _parkedPeersTimeoutId = 0;
+
+    bool _warmStandbyRequested = false;
+    bool _warm = false;
+    guint _warmUpRetryId = 0;
+
+    // peers waiting for tee or for attach batch
     std::set<MessageProxy*> _waitingPeers;
     std::unordered_set<MessageProxy*> _peers;
 };
@@ -39,12 +39,12 @@ bool GstTestStreamer2::prepare() noexcept
         pipelineDesc =
             "videotestsrc name=src ! "
             "x264enc ! video/x-h264, profile=baseline ! rtph264pay pt=96 ! "
-            "tee name=tee";
+            FAN_OUT_FACTORY_NAME " name=tee";
     } else {
         pipelineDesc =
             "videotestsrc name=src ! "
             "vp8enc ! rtpvp8pay pt=96 ! "
-            "tee name=tee";
+            FAN_OUT_FACTORY_NAME " name=tee";
     }
 
     GError* parseError = nullptr;
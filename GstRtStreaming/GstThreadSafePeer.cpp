@@ -0,0 +1,305 @@
+#include "GstThreadSafePeer.h"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "GstPeerEventChannel.h"
+
+
+struct GstThreadSafePeer::Client
+{
+    void attach(
+        const PreparedCallback&,
+        const IceCandidateCallback&,
+        const EosCallback&) noexcept;
+    // returns true if called from client's callback
+    bool detach() noexcept;
+
+    // will be called from peer's context
+    void onPrepared() noexcept;
+    void onIceCandidate(unsigned mlineIndex, const std::string& candidate) noexcept;
+    void onEos() noexcept;
+
+    // should be called with mutex locked
+    void enterCallback() noexcept;
+    void leaveCallback() noexcept;
+
+    // accessed from peer's context only
+    std::unique_ptr<WebRTCPeer> peer;
+
+    // callbacks are called with mutex unlocked,
+    // since client can take its own locks both in callbacks and around peer's destruction
+    std::mutex mutex;
+    std::condition_variable callbacksDone;
+    unsigned callbacksRunning = 0;
+    std::thread::id callbackThread;
+
+    PreparedCallback prepared;
+    IceCandidateCallback iceCandidate;
+    EosCallback eos;
+
+    std::string sdp;
+    std::atomic<bool> finished { false };
+};
+
+void GstThreadSafePeer::Client::attach(
+    const PreparedCallback& prepared,
+    const IceCandidateCallback& iceCandidate,
+    const EosCallback& eos) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->prepared = prepared;
+    this->iceCandidate = iceCandidate;
+    this->eos = eos;
+}
+
+bool GstThreadSafePeer::Client::detach() noexcept
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    prepared = nullptr;
+    iceCandidate = nullptr;
+    eos = nullptr;
+
+    if(callbacksRunning && callbackThread == std::this_thread::get_id())
+        return true;
+
+    // waits for callback running on peer's context (if any)
+    callbacksDone.wait(lock, [this] () { return callbacksRunning == 0; });
+
+    return false;
+}
+
+void GstThreadSafePeer::Client::enterCallback() noexcept
+{
+    ++callbacksRunning;
+    callbackThread = std::this_thread::get_id();
+}
+
+void GstThreadSafePeer::Client::leaveCallback() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--callbacksRunning)
+            return;
+
+        callbackThread = std::thread::id();
+    }
+
+    callbacksDone.notify_all();
+}
+
+void GstThreadSafePeer::Client::onPrepared() noexcept
+{
+    PreparedCallback prepared;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        sdp = peer->sdp();
+
+        if(!this->prepared)
+            return;
+
+        prepared = this->prepared;
+        enterCallback();
+    }
+
+    prepared();
+
+    leaveCallback();
+}
+
+void GstThreadSafePeer::Client::onIceCandidate(
+    unsigned mlineIndex,
+    const std::string& candidate) noexcept
+{
+    IceCandidateCallback iceCandidate;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(!this->iceCandidate)
+            return;
+
+        iceCandidate = this->iceCandidate;
+        enterCallback();
+    }
+
+    iceCandidate(mlineIndex, candidate);
+
+    leaveCallback();
+}
+
+void GstThreadSafePeer::Client::onEos() noexcept
+{
+    finished = true;
+
+    EosCallback eos;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(!this->eos)
+            return;
+
+        eos = this->eos;
+        enterCallback();
+    }
+
+    eos();
+
+    leaveCallback();
+}
+
+GstThreadSafePeer::GstThreadSafePeer(
+    GMainContext* context,
+    MessageProxy* messageProxy,
+    std::unique_ptr<WebRTCPeer>&& peer) noexcept :
+    _context(g_main_context_ref(context ? context : g_main_context_default())),
+    _messageProxyPtr(static_cast<MessageProxy*>(g_object_ref(messageProxy))),
+    _client(std::make_shared<Client>())
+{
+    _client->peer = std::move(peer);
+}
+
+GstThreadSafePeer::~GstThreadSafePeer()
+{
+    const bool insideCallback = _client->detach();
+
+    // owner of the source could expect peer is gone right away (if it's possible at all).
+    // Calls still queued for the peer are skipped then.
+    // Message proxy is released on peer's context too, since source watches its destruction
+    if(!insideCallback && g_main_context_acquire(_context)) {
+        _client->peer.reset();
+        _messageProxyPtr.reset();
+        g_main_context_release(_context);
+    } else {
+        std::shared_ptr<Client> client = _client;
+        MessageProxy* messageProxy = _messageProxyPtr.release();
+        GstPeerEventChannel::PostCall(
+            messageProxy,
+            [client, messageProxy] () {
+                client->peer.reset();
+                g_object_unref(messageProxy);
+            });
+    }
+
+    g_main_context_unref(_context);
+}
+
+void GstThreadSafePeer::post(std::function<void (WebRTCPeer*)>&& call) noexcept
+{
+    std::shared_ptr<Client> client = _client;
+    GstPeerEventChannel::PostCall(
+        _messageProxyPtr.get(),
+        [client, call = std::move(call)] () {
+            if(client->peer)
+                call(client->peer.get());
+        });
+}
+
+void GstThreadSafePeer::prepare(
+    const WebRTCConfigPtr& webRTCConfig,
+    const PreparedCallback& prepared,
+    const IceCandidateCallback& iceCandidate,
+    const EosCallback& eos,
+    const std::string& logContext) noexcept
+{
+    _client->attach(prepared, iceCandidate, eos);
+
+    // peer owns callbacks, so client is referenced only until peer is destroyed
+    std::shared_ptr<Client> client = _client;
+    post([client, webRTCConfig, logContext] (WebRTCPeer* peer) {
+        peer->prepare(
+            webRTCConfig,
+            [client] () { client->onPrepared(); },
+            [client] (unsigned mlineIndex, const std::string& candidate) {
+                client->onIceCandidate(mlineIndex, candidate);
+            },
+            [client] () { client->onEos(); },
+            logContext);
+    });
+}
+
+const std::string& GstThreadSafePeer::sdp() noexcept
+{
+    // client's copy is updated on peer's context
+    std::lock_guard<std::mutex> lock(_client->mutex);
+    _sdp = _client->sdp;
+    return _sdp;
+}
+
+void GstThreadSafePeer::setRemoteSdp(const std::string& sdp) noexcept
+{
+    post([sdp] (WebRTCPeer* peer) { peer->setRemoteSdp(sdp); });
+}
+
+void GstThreadSafePeer::addIceCandidate(
+    unsigned mlineIndex,
+    const std::string& candidate) noexcept
+{
+    post([mlineIndex, candidate] (WebRTCPeer* peer) {
+        peer->addIceCandidate(mlineIndex, candidate);
+    });
+}
+
+void GstThreadSafePeer::play() noexcept
+{
+    post([] (WebRTCPeer* peer) { peer->play(); });
+}
+
+void GstThreadSafePeer::stop() noexcept
+{
+    post([] (WebRTCPeer* peer) { peer->stop(); });
+}
+
+void GstThreadSafePeer::pause() noexcept
+{
+    post([] (WebRTCPeer* peer) { peer->pause(); });
+}
+
+void GstThreadSafePeer::resume() noexcept
+{
+    post([] (WebRTCPeer* peer) { peer->resume(); });
+}
+
+void GstThreadSafePeer::detachClient() noexcept
+{
+    _client->detach();
+
+    post([] (WebRTCPeer* peer) { peer->detachClient(); });
+}
+
+void GstThreadSafePeer::getStats(const StatsCallback& statsCallback) noexcept
+{
+    post([statsCallback] (WebRTCPeer* peer) { peer->getStats(statsCallback); });
+}
+
+bool GstThreadSafePeer::restartIce(
+    const PreparedCallback& prepared,
+    const IceCandidateCallback& iceCandidate,
+    const EosCallback& eos,
+    const std::string& logContext) noexcept
+{
+    if(_client->finished)
+        return false;
+
+    _client->attach(prepared, iceCandidate, eos);
+
+    std::shared_ptr<Client> client = _client;
+    post([client, logContext] (WebRTCPeer* peer) {
+        const bool restarted =
+            peer->restartIce(
+                [client] () { client->onPrepared(); },
+                [client] (unsigned mlineIndex, const std::string& candidate) {
+                    client->onIceCandidate(mlineIndex, candidate);
+                },
+                [client] () { client->onEos(); },
+                logContext);
+        if(!restarted)
+            client->onEos();
+    });
+
+    return true;
+}
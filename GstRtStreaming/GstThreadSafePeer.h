@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+
+#include <glib.h>
+
+#include "../WebRTCPeer.h"
+
+#include "MessageProxy.h"
+
+
+// Makes peer usable from any thread:
+// every call is posted to context peer lives on (see GstPeerEventChannel),
+// calls of the same peer are made in the order they were issued.
+// Callbacks are still called on peer's context (without any internal lock held),
+// but never after destructor (or detachClient()) has returned:
+// callback running on other thread at that moment is waited for
+class GstThreadSafePeer : public WebRTCPeer
+{
+public:
+    // takes references to context and message proxy of wrapped peer,
+    // nullptr context means default main context
+    GstThreadSafePeer(GMainContext*, MessageProxy*, std::unique_ptr<WebRTCPeer>&&) noexcept;
+    // wrapped peer is destroyed right away if context is not run by other thread,
+    // otherwise asynchronously on its context
+    ~GstThreadSafePeer();
+
+    void prepare(
+        const WebRTCConfigPtr&,
+        const PreparedCallback&,
+        const IceCandidateCallback&,
+        const EosCallback&,
+        const std::string& logContext) noexcept override;
+
+    // snapshot taken right before PreparedCallback call,
+    // so is safe to use from that callback or after it.
+    // Returned reference is valid till next call
+    const std::string& sdp() noexcept override;
+
+    void setRemoteSdp(const std::string& sdp) noexcept override;
+    void addIceCandidate(
+        unsigned mlineIndex,
+        const std::string& candidate) noexcept override;
+
+    void play() noexcept override;
+    void stop() noexcept override;
+
+    void pause() noexcept override;
+    void resume() noexcept override;
+
+    void detachClient() noexcept override;
+
+    void getStats(const StatsCallback&) noexcept override;
+
+    // result is optimistic: if wrapped peer refuses restart, EosCallback is called
+    bool restartIce(
+        const PreparedCallback&,
+        const IceCandidateCallback&,
+        const EosCallback&,
+        const std::string& logContext) noexcept override;
+
+private:
+    struct Client;
+
+    void post(std::function<void (WebRTCPeer*)>&&) noexcept;
+
+private:
+    GMainContext* const _context;
+    MessageProxyPtr _messageProxyPtr;
+    const std::shared_ptr<Client> _client;
+    std::string _sdp;
+};
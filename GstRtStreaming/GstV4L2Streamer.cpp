@@ -78,14 +78,14 @@ bool GstV4L2Streamer::prepare() noexcept
             "capsfilter name=sourceFilter ! "
             "v4l2h264enc ! "
             "capsfilter name=encoderFilter ! "
-            "rtph264pay pt=99 config-interval=-1 ! tee name = tee";
+            "rtph264pay pt=99 config-interval=-1 ! " FAN_OUT_FACTORY_NAME " name=tee";
     } else {
         pipelineDesc =
             "v4l2src ! "
             "capsfilter name=sourceFilter ! "
             "x264enc ! "
             "capsfilter name=encoderFilter ! "
-            "rtph264pay pt=99 config-interval=-1 ! tee name = tee";
+            "rtph264pay pt=99 config-interval=-1 ! " FAN_OUT_FACTORY_NAME " name=tee";
     }
 
     GError* parseError = nullptr;
@@ -34,7 +34,8 @@ protected:
     void setWebRtcBin(const WebRTCConfig&, GstElementPtr&&) noexcept override;
 
     void setState(GstState) noexcept;
-    void pause() noexcept;
+    void pause() noexcept override;
+    void resume() noexcept override { play(); }
     void play() noexcept final override;
     void stop() noexcept final override;
 
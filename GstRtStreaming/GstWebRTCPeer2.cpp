@@ -5,13 +5,43 @@
 #include <gst/gst.h>
 #include <gst/pbutils/pbutils.h>
 #include <gst/webrtc/rtptransceiver.h>
+#include <gst/webrtc/webrtc.h>
 
 #include <CxxPtr/GlibPtr.h>
 #include <CxxPtr/GstWebRtcPtr.h>
 
+#include "GstPeerReaper.h"
+#include "GstPeerEventChannel.h"
+#include "GstLoadGovernor.h"
+#include "GstPeerStatsSampler.h"
+#include "GstWebRtcBinPool.h"
 
-GstWebRTCPeer2::GstWebRTCPeer2(MessageProxyPtr&& messageProxyPtr) :
-    _messageProxyPtr(std::move(messageProxyPtr))
+
+namespace {
+
+// in buffers, about a dozen of frames of typical video stream
+const guint SendOnlyLiteQueueSize = 100;
+
+// "ice-restart" offer option is silently ignored by webrtcbin before 1.20,
+// and offer with old ICE credentials would never reconnect client
+bool IceRestartSupported()
+{
+#if GST_CHECK_VERSION(1, 20, 0)
+    guint major, minor, micro, nano;
+    gst_version(&major, &minor, &micro, &nano);
+    return major > 1 || (major == 1 && minor >= 20);
+#else
+    return false;
+#endif
+}
+
+}
+
+GstWebRTCPeer2::GstWebRTCPeer2(
+    MessageProxyPtr&& messageProxyPtr,
+    GstRtStreaming::PeerPriority priority) :
+    _messageProxyPtr(std::move(messageProxyPtr)),
+    _priority(priority)
 {
     MessageProxy* messageProxy = _messageProxyPtr.get();
 
@@ -25,16 +55,13 @@ GstWebRTCPeer2::GstWebRTCPeer2(MessageProxyPtr&& messageProxyPtr) :
         };
     _teeHandlerId = g_signal_connect(messageProxy, "tee", G_CALLBACK(onTeeCallback), this);
 
-    auto onMessageCallback =
-        + [] (MessageProxy*, GstMessage* message, gpointer userData) {
+    auto onEventCallback =
+        + [] (gconstpointer event, gpointer userData) {
             GstWebRTCPeer2* owner = static_cast<GstWebRTCPeer2*>(userData);
-            return owner->onMessage(message);
+            owner->onEvent(*static_cast<const GstPeerEventChannel::Event*>(event));
         };
-    _messageHandlerId = g_signal_connect(
-        messageProxy,
-        "message",
-        G_CALLBACK(onMessageCallback),
-        this);
+    // events are posted by webrtcbin callbacks, bypassing pipeline bus
+    message_proxy_set_event_handler(messageProxy, onEventCallback, this);
 
     auto onEosCallback =
         + [] (MessageProxy*, gboolean error, gpointer userData) {
@@ -42,68 +69,30 @@ GstWebRTCPeer2::GstWebRTCPeer2(MessageProxyPtr&& messageProxyPtr) :
             return owner->onEos(error);
         };
     _eosHandlerId = g_signal_connect(messageProxy, "eos", G_CALLBACK(onEosCallback), this);
-}
-
-namespace {
-
-struct TeardownData
-{
-    std::atomic_flag guard = ATOMIC_FLAG_INIT;
-
-    GstElementPtr pipelinePtr;
-    GstElementPtr teePtr;
-    GstElementPtr queuePtr;
-    GstElementPtr rtcbinPtr;
-};
-
-GstPadProbeReturn
-RemovePeerElements(
-    GstPad* teeSrcPad,
-    GstPadProbeInfo*,
-    gpointer userData)
-{
-    TeardownData* data = static_cast<TeardownData*>(userData);
-
-    if(data->guard.test_and_set())
-        return GST_PAD_PROBE_OK;
-
-    GstElement* pipeline = data->pipelinePtr.get();
-    GstElement* tee = data->teePtr.get();
-    GstElement* queue = data->queuePtr.get();
-    GstElement* rtcbin = data->rtcbinPtr.get();
-
-    GstPadPtr queueSinkPadPtr(gst_element_get_static_pad(queue, "sink"));
-    gst_pad_unlink(teeSrcPad, queueSinkPadPtr.get());
-    gst_element_release_request_pad(tee, teeSrcPad);
-
-    GstPadPtr queueSrcPadPtr(gst_element_get_static_pad(queue, "src"));
-    GstPadPtr rtcbinSinkPadPtr(gst_pad_get_peer(queueSrcPadPtr.get()));
-    gst_element_release_request_pad(rtcbin, rtcbinSinkPadPtr.get());
-
-    // it looks like order of state change is important
-    // since queue's src pad thread can be blocked by probe deep inside webrtcbin
-    gst_element_set_state(rtcbin, GST_STATE_NULL);
-    gst_element_set_state(queue, GST_STATE_NULL);
-
-    gst_bin_remove_many(GST_BIN(pipeline), queue, rtcbin, NULL);
-
-    return GST_PAD_PROBE_REMOVE;
-}
 
+    GstLoadGovernor::Register(this, priority);
 }
 
 GstWebRTCPeer2::~GstWebRTCPeer2()
 {
+    GstLoadGovernor::Unregister(this);
+    GstPeerStatsSampler::Unregister(this);
+
     MessageProxy* messageProxy = _messageProxyPtr.get();
 
     g_signal_handler_disconnect(messageProxy, _teeHandlerId);
-    g_signal_handler_disconnect(messageProxy, _messageHandlerId);
+    // events still queued for this peer are dropped
+    message_proxy_set_event_handler(messageProxy, nullptr, nullptr);
     g_signal_handler_disconnect(messageProxy, _eosHandlerId);
 
     GstElement* rtcbin = webRtcBin();
     if(rtcbin) {
         if(_onNegotiationNeededHandlerId)
             g_signal_handler_disconnect(rtcbin, _onNegotiationNeededHandlerId);
+
+        // webrtcbin outlives peer (in reaper, load governor etc.),
+        // so late errors from it shouldn't be routed anywhere
+        g_object_set_qdata(G_OBJECT(rtcbin), PeerQuark(), nullptr);
     }
 
     _messageProxyPtr.reset();
@@ -111,155 +100,96 @@ GstWebRTCPeer2::~GstWebRTCPeer2()
     if(!_teePtr)
         return; // nothing to teardown
 
-    GstPadPtr teeSinkPadPtr(gst_element_get_static_pad(_teePtr.get(), "sink"));
-    GstPadPtr teePeerSrcPadPtr(gst_pad_get_peer(teeSinkPadPtr.get()));
-
-    if(!_prepared.test_and_set()) {
+    if(!_prepared) {
         log()->warn("Peer was not prepared. Skipping teardown...");
-        g_assert(_prepareProbe);
-        gst_pad_remove_probe(teePeerSrcPadPtr.get(), _prepareProbe);
     } else {
         log()->debug("Teardown peer...");
-        TeardownData* data = new TeardownData {
-            .pipelinePtr = GstElementPtr(GST_ELEMENT(gst_object_ref(pipeline()))),
-            .teePtr = std::move(_teePtr),
-            .queuePtr = std::move(_queuePtr),
-            .rtcbinPtr = GstElementPtr(GST_ELEMENT(gst_object_ref(webRtcBin()))),
-        };
 
-        GstPadPtr queueSinkPadPtr(gst_element_get_static_pad(data->queuePtr.get(), "sink"));
-        GstPadPtr teeSrcPadPtr(gst_pad_get_peer(queueSinkPadPtr.get()));
-
-        gst_pad_add_probe(
-            teeSrcPadPtr.get(),
-            GST_PAD_PROBE_TYPE_IDLE,
-            RemovePeerElements,
-            data,
-            [] (void* userData) { delete static_cast<TeardownData*>(userData); });
+        // fan out pad release is safe from any thread,
+        // so detach is just handed to reaper and batched with other peers leaving
+        std::vector<GstElementPtr> elements;
+        elements.emplace_back(GST_ELEMENT(gst_object_ref(webRtcBin())));
+        GstPeerReaper::Detach(
+            std::move(_teePtr),
+            std::move(_teePadPtr),
+            GstElementPtr(GST_ELEMENT(gst_object_ref(pipeline()))),
+            std::move(elements));
     }
 }
 
-void GstWebRTCPeer2::onMessage(GstMessage* message)
+void GstWebRTCPeer2::onEvent(const GstPeerEventChannel::Event& event)
 {
-    const GstStructure* structure =
-        gst_message_get_structure(message);
-    assert(structure);
-    if(!structure)
-        return;
-
-    if(gst_message_has_name(message, "ice-candidate")) {
-        guint mlineIndex = 0;
-        gst_structure_get_uint(structure, "mline-index", &mlineIndex);
-        const gchar* candidate = gst_structure_get_string(structure, "candidate");
-        onIceCandidate(mlineIndex, candidate);
-    } else if(gst_message_has_name(message, "sdp")) {
-        const gchar* sdp = gst_structure_get_string(structure, "sdp");
-        onSdp(sdp);
-    } else if(gst_message_has_name(message, "eos")) {
-        gboolean error = FALSE;
-        gst_structure_get_boolean(structure, "error", &error);
-        onEos(error != FALSE);
+    switch(event.type) {
+    case GstPeerEventChannel::Event::Type::IceCandidate:
+        onIceCandidate(event.mlineIndex, event.payload.c_str());
+        break;
+    case GstPeerEventChannel::Event::Type::Sdp:
+        onSdp(event.payload.c_str());
+        break;
+    case GstPeerEventChannel::Event::Type::Eos:
+        onEos(event.error);
+        break;
     }
 }
 
 // will be called from streaming thread
 void GstWebRTCPeer2::postIceCandidate(
     MessageProxy* messageProxy,
-    GstElement* rtcbin,
     guint mlineIndex,
     const gchar* candidate)
 {
-    GstBusPtr busPtr(gst_element_get_bus(rtcbin));
-    GstBus* bus = busPtr.get();
-    if(!bus)
-        return;
-
-    GValue candidateValue = G_VALUE_INIT;
-    g_value_init(&candidateValue, G_TYPE_STRING);
-    g_value_take_string(&candidateValue, g_strdup(candidate));
-
-    GstStructure* structure =
-        gst_structure_new(
-            "ice-candidate",
-            "mline-index", G_TYPE_UINT, mlineIndex,
-            nullptr);
-
-    gst_structure_set(
-        structure,
-        "target", MESSAGE_PROXY_TYPE, messageProxy,
-        NULL);
-
-    gst_structure_take_value(
-        structure,
-        "candidate",
-        &candidateValue);
-
-    GstMessage* message =
-        gst_message_new_application(GST_OBJECT(rtcbin), structure);
-
-    gst_bus_post(bus, message);
+    GstPeerEventChannel::PostIceCandidate(messageProxy, mlineIndex, candidate);
 }
 
 // will be called from streaming thread
 void GstWebRTCPeer2::postSdp(
     MessageProxy* messageProxy,
-    GstElement* rtcbin,
     const gchar* sdp)
 {
-    GstBusPtr busPtr(gst_element_get_bus(rtcbin));
-    GstBus* bus = busPtr.get();
-    if(!bus)
-        return;
-
-    GValue sdpValue = G_VALUE_INIT;
-    g_value_init(&sdpValue, G_TYPE_STRING);
-    g_value_take_string(&sdpValue, g_strdup(sdp));
-
-    GstStructure* structure =
-        gst_structure_new_empty("sdp");
-
-    gst_structure_set(
-        structure,
-        "target", MESSAGE_PROXY_TYPE, messageProxy,
-        NULL);
-
-    gst_structure_take_value(
-        structure,
-        "sdp",
-        &sdpValue);
-
-    GstMessage* message =
-        gst_message_new_application(GST_OBJECT(rtcbin), structure);
-
-    gst_bus_post(bus, message);
+    GstPeerEventChannel::PostSdp(messageProxy, sdp);
 }
 
 // will be called from streaming thread
 void GstWebRTCPeer2::postEos(
     MessageProxy* messageProxy,
-    GstElement* rtcbin,
     gboolean error)
 {
-    GstBusPtr busPtr(gst_element_get_bus(rtcbin));
-    GstBus* bus = busPtr.get();
-    if(!bus)
-        return;
+    GstPeerEventChannel::PostEos(messageProxy, error != FALSE);
+}
 
-    GstStructure* structure =
-        gst_structure_new(
-            "eos",
-            "error", G_TYPE_BOOLEAN, error,
-            nullptr);
+GQuark GstWebRTCPeer2::PeerQuark() noexcept
+{
+    static const GQuark quark = g_quark_from_static_string("rtstreaming-peer");
+    return quark;
+}
 
-    gst_structure_set(
-        structure,
-        "target", MESSAGE_PROXY_TYPE, messageProxy,
-        NULL);
+MessageProxyPtr GstWebRTCPeer2::PeerMessageProxy(GstObject* object) noexcept
+{
+    // qdata can be cleared by peer's destructor concurrently
+    auto refMessageProxy =
+        + [] (gpointer messageProxy, gpointer) -> gpointer {
+            return messageProxy ? g_object_ref(messageProxy) : nullptr;
+        };
+
+    for(GstObjectPtr objectPtr(GST_OBJECT(gst_object_ref(object)));
+        objectPtr;
+        objectPtr.reset(gst_object_get_parent(objectPtr.get())))
+    {
+        if(gpointer messageProxy =
+            g_object_dup_qdata(G_OBJECT(objectPtr.get()), PeerQuark(), refMessageProxy, nullptr))
+        {
+            return MessageProxyPtr(static_cast<MessageProxy*>(messageProxy));
+        }
+    }
 
-    GstMessage* message =
-        gst_message_new_application(GST_OBJECT(rtcbin), structure);
+    return MessageProxyPtr();
+}
 
-    gst_bus_post(bus, message);
+void GstWebRTCPeer2::Disconnect(GstElement* rtcbin) noexcept
+{
+    // event is dispatched on context of the source, where peer lives
+    if(MessageProxyPtr messageProxyPtr = PeerMessageProxy(GST_OBJECT(rtcbin)))
+        postEos(messageProxyPtr.get(), TRUE);
 }
 
 GstElement* GstWebRTCPeer2::tee() const noexcept
@@ -267,9 +197,65 @@ GstElement* GstWebRTCPeer2::tee() const noexcept
     return _teePtr.get();
 }
 
-GstElement* GstWebRTCPeer2::queue() const noexcept
+GstPad* GstWebRTCPeer2::teePad() const noexcept
 {
-    return _queuePtr.get();
+    return _teePadPtr.get();
+}
+
+guint64 GstWebRTCPeer2::droppedFrames() const noexcept
+{
+    if(!_teePadPtr)
+        return 0;
+
+    guint64 droppedFrames = 0;
+    g_object_get(_teePadPtr.get(), "dropped-frames", &droppedFrames, nullptr);
+
+    return droppedFrames;
+}
+
+void GstWebRTCPeer2::pause() noexcept
+{
+    _paused = true;
+
+    if(_teePadPtr)
+        g_object_set(_teePadPtr.get(), "paused", TRUE, nullptr);
+}
+
+void GstWebRTCPeer2::resume() noexcept
+{
+    _paused = false;
+
+    if(_teePadPtr)
+        g_object_set(_teePadPtr.get(), "paused", FALSE, nullptr);
+}
+
+
+GstClockTime GstWebRTCPeer2::timeToFirstFrame() const noexcept
+{
+    if(!_teePadPtr)
+        return 0;
+
+    guint64 timeToFirstFrame = 0;
+    g_object_get(_teePadPtr.get(), "time-to-first-frame", &timeToFirstFrame, nullptr);
+
+    return timeToFirstFrame;
+}
+
+GstWebRTCPeer2::PacingStats GstWebRTCPeer2::pacingStats() const noexcept
+{
+    PacingStats stats;
+    if(!_teePadPtr)
+        return stats;
+
+    g_object_get(
+        _teePadPtr.get(),
+        "paced-buffers", &stats.pacedBuffers,
+        "pacing-delay", &stats.totalDelay,
+        "max-pacing-delay", &stats.maxDelay,
+        "max-burst", &stats.maxBurst,
+        nullptr);
+
+    return stats;
 }
 
 namespace {
@@ -341,7 +327,7 @@ void GstWebRTCPeer2::prepareWebRtcBin() noexcept
 
     auto onIceCandidateCallback =
         + [] (GstElement* rtcbin, guint candidate, gchar* arg2, MessageProxy* messageProxy) {
-            postIceCandidate(messageProxy, rtcbin, candidate, arg2);
+            postIceCandidate(messageProxy, candidate, arg2);
         };
     g_signal_connect_object(
         rtcbin,
@@ -380,7 +366,7 @@ void GstWebRTCPeer2::onOfferCreated(
 
     if(!sessionDescription) {
         log->error("No offer from \"create-offer\"");
-        postEos(messageProxy, rtcbin, true);
+        postEos(messageProxy, true);
         return;
     }
 
@@ -390,7 +376,7 @@ void GstWebRTCPeer2::onOfferCreated(
         "set-local-description", sessionDescription, NULL);
 
     GCharPtr sdpPtr(gst_sdp_message_as_text(sessionDescription->sdp));
-    postSdp(messageProxy, rtcbin, sdpPtr.get());
+    postSdp(messageProxy, sdpPtr.get());
 }
 
 // will be called from streaming thread
@@ -398,6 +384,15 @@ void GstWebRTCPeer2::onNegotiationNeeded(
     MessageProxy* messageProxy,
     GstElement* rtcbin,
     const std::shared_ptr<spdlog::logger>& log)
+{
+    createOffer(messageProxy, rtcbin, log, false);
+}
+
+void GstWebRTCPeer2::createOffer(
+    MessageProxy* messageProxy,
+    GstElement* rtcbin,
+    const std::shared_ptr<spdlog::logger>& log,
+    bool iceRestart)
 {
     auto onOfferCreatedCallback =
         + [] (GstPromise* promise, gpointer userData) {
@@ -409,7 +404,15 @@ void GstWebRTCPeer2::onNegotiationNeeded(
         onOfferCreatedCallback,
         new PeerData(messageProxy, rtcbin, log, "create-offer"),
         PeerData::Destroy);
-    g_signal_emit_by_name(rtcbin, "create-offer", nullptr, promise);
+
+    GstStructure* options = nullptr;
+    if(iceRestart)
+        options = gst_structure_new("options", "ice-restart", G_TYPE_BOOLEAN, TRUE, nullptr);
+
+    g_signal_emit_by_name(rtcbin, "create-offer", options, promise);
+
+    if(options)
+        gst_structure_free(options);
 }
 
 // will be called from streaming thread
@@ -442,7 +445,7 @@ void GstWebRTCPeer2::onAnswerCreated(
 
     if(!sessionDescription) {
         log->error("No answer from \"create-answer\"");
-        postEos(messageProxy, rtcbin, true);
+        postEos(messageProxy, true);
         return;
     }
 
@@ -450,7 +453,7 @@ void GstWebRTCPeer2::onAnswerCreated(
         "set-local-description", sessionDescription, NULL);
 
     GCharPtr sdpPtr(gst_sdp_message_as_text(sessionDescription->sdp));
-    postSdp(messageProxy, rtcbin, sdpPtr.get());
+    postSdp(messageProxy, sdpPtr.get());
 }
 
 // will be called from streaming thread
@@ -462,7 +465,7 @@ void GstWebRTCPeer2::onIceGatheringStateChanged(
     g_object_get(rtcbin, "ice-gathering-state", &state, NULL);
 
     if(GST_WEBRTC_ICE_GATHERING_STATE_COMPLETE == state)
-        postIceCandidate(messageProxy, rtcbin, 0, nullptr);
+        postIceCandidate(messageProxy, 0, nullptr);
 }
 
 // will be called from streaming thread
@@ -514,7 +517,7 @@ void GstWebRTCPeer2::onSetRemoteDescription(
         break;
     }
     default:
-        GstWebRTCPeer2::postEos(messageProxy, rtcbin, true);
+        GstWebRTCPeer2::postEos(messageProxy, true);
         break;
     }
 }
@@ -561,17 +564,30 @@ void GstWebRTCPeer2::setRemoteSdp(const std::string& sdp) noexcept
         promise);
 }
 
-namespace {
+bool GstWebRTCPeer2::restartIce(
+    const PreparedCallback& prepared,
+    const IceCandidateCallback& iceCandidate,
+    const EosCallback& eos,
+    const std::string& logContext) noexcept
+{
+    GstElement* rtcbin = webRtcBin();
+    if(!_prepared || !rtcbin || finished())
+        return false;
 
-struct PrepareData {
-    std::atomic_flag& guard;
+    // caller falls back to fresh peer
+    if(!IceRestartSupported()) {
+        log()->debug("ICE restart is not supported by installed GStreamer");
+        return false;
+    }
 
-    GstElementPtr pipelinePtr;
-    GstElementPtr teePtr;
-    GstElementPtr queuePtr;
-    GstElementPtr rtcBinPtr;
-};
+    reattachClient(prepared, iceCandidate, eos, logContext);
+
+    log()->debug("Restarting ICE...");
 
+    // fan out pad stays linked, so only ICE credentials and candidates are renegotiated
+    createOffer(_messageProxyPtr.get(), rtcbin, log(), true);
+
+    return true;
 }
 
 void GstWebRTCPeer2::internalPrepare() noexcept
@@ -591,85 +607,91 @@ void GstWebRTCPeer2::internalPrepare() noexcept
         return;
     }
 
-    _queuePtr.reset(gst_element_factory_make("queue", nullptr));
-    GstElement* queue = _queuePtr.get();
-    g_object_set(queue, "silent", true, nullptr);
-    gst_util_set_object_arg(G_OBJECT(queue), "leaky", "downstream");
-
-    setWebRtcBin(*_webRTCConfig, GstElementPtr(gst_element_factory_make("webrtcbin", nullptr)));
+    setWebRtcBin(*_webRTCConfig, GstWebRtcBinPool::Acquire(_webRTCConfig));
     GstElement* rtcbin = webRtcBin();
     prepareWebRtcBin();
 
-    GstPadPtr teeSinkPadPtr(gst_element_get_static_pad(tee, "sink"));
-    GstPadPtr teePeerSrcPadPtr(gst_pad_get_peer(teeSinkPadPtr.get()));
+    // to route errors from peer's branch only to that peer
+    g_object_set_qdata_full(
+        G_OBJECT(rtcbin),
+        PeerQuark(),
+        g_object_ref(_messageProxyPtr.get()),
+        g_object_unref);
 
-    PrepareData* prepareData =
-        new PrepareData {
-            _prepared,
-            GstElementPtr(GST_ELEMENT(gst_object_ref(pipeline))),
-            GstElementPtr(GST_ELEMENT(gst_object_ref(tee))),
-            GstElementPtr(GST_ELEMENT(gst_object_ref(queue))),
-            GstElementPtr(GST_ELEMENT(gst_object_ref(rtcbin)))
-        };
-
-    _prepareProbe = gst_pad_add_probe(
-        teePeerSrcPadPtr.get(),
-        GST_PAD_PROBE_TYPE_IDLE,
-        [] (GstPad*, GstPadProbeInfo*, gpointer data) -> GstPadProbeReturn {
-            PrepareData* prepareData = static_cast<PrepareData*>(data);
-            GstElement* pipeline = prepareData->pipelinePtr.get();
-            GstElement* tee = prepareData->teePtr.get();
-            GstElement* queue = prepareData->queuePtr.get();
-            GstElement* rtcbin = prepareData->rtcBinPtr.get();
-
-            if(prepareData->guard.test_and_set())
-                return GST_PAD_PROBE_OK;
-
-            gst_bin_add_many(
-                GST_BIN(pipeline),
-                GST_ELEMENT(gst_object_ref(queue)),
-                GST_ELEMENT(gst_object_ref(rtcbin)),
-                nullptr);
+    GstPeerStatsSampler::Register(this, GstElementPtr(GST_ELEMENT(gst_object_ref(rtcbin))));
 
+    // whole peer branch is built and started off the data path,
+    // so the only operation touching shared tee is the final link,
+    // and streaming for already attached peers is not interrupted
+    gst_bin_add(GST_BIN(pipeline), GST_ELEMENT(gst_object_ref(rtcbin)));
 
-            GstPadPtr teeSrcPadPtr(gst_element_get_request_pad(tee, "src_%u"));
-            GstPadPtr queueSinkPadPtr(gst_element_get_static_pad(queue, "sink"));
+    GstPadPtr rtcbinSinkPadPtr(gst_element_get_request_pad(rtcbin, "sink_%u"));
 
-            if(GST_PAD_LINK_OK != gst_pad_link(teeSrcPadPtr.get(), queueSinkPadPtr.get())) {
-                g_assert(false);
-            }
+    GArray* transceivers;
+    g_signal_emit_by_name(rtcbin, "get-transceivers", &transceivers);
+    for(guint i = 0; i < transceivers->len; ++i) {
+        GstWebRTCRTPTransceiver* transceiver = g_array_index(transceivers, GstWebRTCRTPTransceiver*, i);
+#if GST_CHECK_VERSION(1, 18, 0)
+        g_object_set(transceiver, "direction", GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_SENDONLY, nullptr);
+#else
+        transceiver->direction = GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_SENDONLY;
+#endif
+    }
+    g_array_unref(transceivers);
 
-            GstPadPtr queueSrcPadPtr(gst_element_get_static_pad(queue, "src"));
-            GstPadPtr rtcbinSinkPadPtr(gst_element_get_request_pad(rtcbin, "sink_%u"));
+    if(!gst_element_sync_state_with_parent(rtcbin)) {
+        g_assert(false);
+    }
 
-            if(GST_PAD_LINK_OK != gst_pad_link(queueSrcPadPtr.get(), rtcbinSinkPadPtr.get())) {
-                g_assert(false);
-            }
+    // fan out supports requesting and linking src pads while streaming,
+    // sticky events will be delivered to webrtcbin with the first buffer.
+    // Pad is pushed from shared worker pool, so no per peer queue (and thread) is required
+    _teePadPtr.reset(gst_element_get_request_pad(tee, "src_%u"));
+
+    // webrtcbin blocks buffers till negotiation and transport till DTLS is up,
+    // and blocked push would take worker shared by all peers.
+    // So pad gets only events (caps are required for negotiation) while peer is not connected,
+    // including disconnects and ICE restarts after connection was established
+    g_object_set(_teePadPtr.get(), "hold", TRUE, nullptr);
+    auto onConnectionStateChangedCallback =
+        + [] (GstElement* rtcbin, GParamSpec*, GstPad* teePad) {
+            GstWebRTCPeerConnectionState state = GST_WEBRTC_PEER_CONNECTION_STATE_NEW;
+            g_object_get(rtcbin, "connection-state", &state, nullptr);
+            g_object_set(
+                teePad,
+                "hold", state != GST_WEBRTC_PEER_CONNECTION_STATE_CONNECTED,
+                nullptr);
+        };
+    g_signal_connect_object(
+        rtcbin,
+        "notify::connection-state",
+        G_CALLBACK(onConnectionStateChangedCallback),
+        teePad(),
+        G_CONNECT_DEFAULT);
 
-            if(!gst_element_sync_state_with_parent(queue)) {
-                g_assert(false);
-            }
+    if(_paused)
+        g_object_set(_teePadPtr.get(), "paused", TRUE, nullptr);
+    if(_webRTCConfig->peerProfile == WebRTCConfig::PeerProfile::SendOnlyLite)
+        g_object_set(_teePadPtr.get(), "max-size-buffers", SendOnlyLiteQueueSize, nullptr);
+    if(_webRTCConfig->pacingFactor > 0) {
+        g_object_set(
+            _teePadPtr.get(),
+            "pacing-factor", _webRTCConfig->pacingFactor,
+            "pacing-max-delay",
+                guint64(std::chrono::nanoseconds(_webRTCConfig->pacingMaxDelay).count()),
+            nullptr);
+    }
 
-            if(!gst_element_sync_state_with_parent(rtcbin)) {
-                g_assert(false);
-            }
+    GstLoadGovernor::Attach(
+        this,
+        GstPadPtr(GST_PAD(gst_object_ref(teePad()))),
+        GstElementPtr(GST_ELEMENT(gst_object_ref(rtcbin))));
 
-            GArray* transceivers;
-            g_signal_emit_by_name(rtcbin, "get-transceivers", &transceivers);
-            for(guint i = 0; i < transceivers->len; ++i) {
-                GstWebRTCRTPTransceiver* transceiver = g_array_index(transceivers, GstWebRTCRTPTransceiver*, i);
-#if GST_CHECK_VERSION(1, 18, 0)
-                g_object_set(transceiver, "direction", GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_SENDONLY, nullptr);
-#else
-                transceiver->direction = GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_SENDONLY;
-#endif
-            }
-            g_array_unref(transceivers);
+    if(GST_PAD_LINK_OK != gst_pad_link(teePad(), rtcbinSinkPadPtr.get())) {
+        g_assert(false);
+    }
 
-            return GST_PAD_PROBE_REMOVE;
-        },
-        prepareData,
-        [] (gpointer data) { delete(static_cast<PrepareData*>(data)); });
+    _prepared = true;
 }
 
 void GstWebRTCPeer2::prepare(
@@ -681,6 +703,9 @@ void GstWebRTCPeer2::prepare(
 {
     _webRTCConfig = webRTCConfig;
 
+    // in case of first peer with that config pool starts to fill only now
+    GstWebRtcBinPool::Prewarm(webRTCConfig);
+
     GstWebRTCPeerBase::attachClient(prepared, iceCandidate, eos, logContext);
 
     internalPrepare();
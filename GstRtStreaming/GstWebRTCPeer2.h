@@ -4,7 +4,9 @@
 
 #include "CxxPtr/GstPtr.h"
 
+#include "Types.h"
 #include "GstWebRTCPeerBase.h"
+#include "GstPeerEventChannel.h"
 
 #include "MessageProxy.h"
 
@@ -12,7 +14,16 @@
 class GstWebRTCPeer2 : public GstWebRTCPeerBase
 {
 public:
-    GstWebRTCPeer2(MessageProxyPtr&&);
+    // thread safe
+    // returns message proxy of the peer which owns given object (if any)
+    static MessageProxyPtr PeerMessageProxy(GstObject*) noexcept;
+    // thread safe
+    // finishes peer owning given webrtcbin with error asynchronously
+    static void Disconnect(GstElement* rtcbin) noexcept;
+
+    GstWebRTCPeer2(
+        MessageProxyPtr&&,
+        GstRtStreaming::PeerPriority = GstRtStreaming::PeerPriority::Normal);
     ~GstWebRTCPeer2();
 
     void prepare(
@@ -24,36 +35,66 @@ public:
 
     void setRemoteSdp(const std::string& sdp) noexcept override;
 
+    bool restartIce(
+        const PreparedCallback&,
+        const IceCandidateCallback&,
+        const EosCallback&,
+        const std::string& logContext) noexcept override;
+
+    // stream restarts from key frame on resume
+    void pause() noexcept override;
+    void resume() noexcept override;
+
+    // frames skipped because peer couldn't keep up with stream
+    guint64 droppedFrames() const noexcept;
+    // time between attach and first buffer sent to peer, 0 if nothing was sent yet
+    GstClockTime timeToFirstFrame() const noexcept;
+
+    struct PacingStats {
+        guint64 pacedBuffers = 0; // buffers held by pacer
+        GstClockTime totalDelay = 0;
+        GstClockTime maxDelay = 0;
+        guint maxBurst = 0; // buffers sent less than 1ms apart
+    };
+    PacingStats pacingStats() const noexcept;
+
+    GstRtStreaming::PeerPriority priority() const noexcept
+        { return _priority; }
+
 protected:
     GstElement* tee() const noexcept;
-    GstElement* queue() const noexcept;
+    GstPad* teePad() const noexcept;
 
-    void onMessage(GstMessage*);
+    void onEvent(const GstPeerEventChannel::Event&);
 
 private:
     void play() noexcept override {}
     void stop() noexcept override {}
 
+    static GQuark PeerQuark() noexcept;
+
     static void onNegotiationNeeded(
         MessageProxy*,
         GstElement* rtcbin,
         const std::shared_ptr<spdlog::logger>& log);
+    static void createOffer(
+        MessageProxy*,
+        GstElement* rtcbin,
+        const std::shared_ptr<spdlog::logger>& log,
+        bool iceRestart);
     static void onIceGatheringStateChanged(
         MessageProxy*,
         GstElement* rtcbin);
 
     static void postIceCandidate(
         MessageProxy*,
-        GstElement* rtcbin,
         guint mlineIndex,
         const gchar* candidate);
     static void postSdp(
         MessageProxy*,
-        GstElement* rtcbin,
         const gchar* sdp);
     static void postEos(
         MessageProxy*,
-        GstElement* rtcbin,
         gboolean error);
 
     static void onOfferCreated(
@@ -77,8 +118,8 @@ private:
 
 private:
     MessageProxyPtr _messageProxyPtr;
+    const GstRtStreaming::PeerPriority _priority;
     gulong _teeHandlerId = 0;
-    gulong _messageHandlerId = 0;
     gulong _eosHandlerId = 0;
 
     gulong _onNegotiationNeededHandlerId = 0;
@@ -86,8 +127,8 @@ private:
     WebRTCConfigPtr _webRTCConfig;
 
     GstElementPtr _teePtr;
-    GstElementPtr _queuePtr;
+    GstPadPtr _teePadPtr;
 
-    std::atomic_flag _prepared = ATOMIC_FLAG_INIT;
-    gulong _prepareProbe = 0;
+    bool _prepared = false;
+    bool _paused = false;
 };
@@ -1,10 +1,12 @@
 #include "GstWebRTCPeerBase.h"
 
 #include <cassert>
+#include <algorithm>
 
 #include <gst/gst.h>
 #include <gst/pbutils/pbutils.h>
 #include <gst/webrtc/rtptransceiver.h>
+#include <gst/webrtc/webrtc.h>
 #include <nice/agent.h>
 
 #include <CxxPtr/GlibPtr.h>
@@ -47,6 +49,30 @@ bool GstWebRTCPeerBase::clientAttached() const noexcept
     return _clientAttached;
 }
 
+void GstWebRTCPeerBase::reattachClient(
+    const PreparedCallback& prepared,
+    const IceCandidateCallback& iceCandidate,
+    const EosCallback& eos,
+    const std::string& logContext) noexcept
+{
+    assert(_clientAttached);
+
+    _log = MakeGstRtStreamingMtLogger(_log->name(), logContext);
+
+    _preparedCallback = prepared;
+    _iceCandidateCallback = iceCandidate;
+    _eosCallback = eos;
+
+    _sdp.clear();
+}
+
+void GstWebRTCPeerBase::detachClient() noexcept
+{
+    _preparedCallback = nullptr;
+    _iceCandidateCallback = nullptr;
+    _eosCallback = nullptr;
+}
+
 void GstWebRTCPeerBase::setPipeline(GstElement* pipeline) noexcept
 {
     setPipeline(GstElementPtr(GST_ELEMENT(gst_object_ref(pipeline))));
@@ -134,11 +160,11 @@ void GstWebRTCPeerBase::setWebRtcBin(
 
     _rtcbinPtr = std::move(rtcbinPtr);
 
-    setIceServers(webRTCConfig);
-
     GstElement* rtcbin = webRtcBin();
 
-    g_object_set(rtcbin, "bundle-policy", GST_WEBRTC_BUNDLE_POLICY_MAX_COMPAT, nullptr);
+    // could be already done by GstWebRtcBinPool
+    if(!g_object_get_qdata(G_OBJECT(rtcbin), ConfiguredQuark()))
+        ConfigureWebRtcBin(webRTCConfig, rtcbin);
 
     auto onConnectionStateChangedCallback =
         + [] (GstElement* rtcbin, GParamSpec*, gpointer userData) {
@@ -188,13 +214,6 @@ void GstWebRTCPeerBase::setWebRtcBin(
         if(iceAgent) {
             GstObjectPtr iceAgentPtr(iceAgent);
 
-            if(IsMinMaxRtpPortAvailable) {
-                if(webRTCConfig.minRtpPort)
-                    g_object_set(iceAgent, "min-rtp-port", webRTCConfig.minRtpPort.value(), nullptr);
-                if(webRTCConfig.maxRtpPort)
-                    g_object_set(iceAgent, "max-rtp-port", webRTCConfig.maxRtpPort.value(), nullptr);
-            }
-
             NiceAgent* niceAgent = nullptr;
             g_object_get(iceAgent, "agent", &niceAgent, NULL);
 
@@ -234,6 +253,188 @@ void GstWebRTCPeerBase::setWebRtcBin(
     }
 }
 
+GQuark GstWebRTCPeerBase::ConfiguredQuark() noexcept
+{
+    static const GQuark quark = g_quark_from_static_string("rtstreaming-webrtcbin-configured");
+    return quark;
+}
+
+void GstWebRTCPeerBase::ConfigureWebRtcBin(
+    const WebRTCConfig& webRTCConfig,
+    GstElement* rtcbin) noexcept
+{
+    SetIceServers(webRTCConfig, rtcbin);
+
+    const bool lite = webRTCConfig.peerProfile == WebRTCConfig::PeerProfile::SendOnlyLite;
+
+    // with max-bundle all media share single ICE/DTLS transport
+    g_object_set(
+        rtcbin,
+        "bundle-policy",
+        lite ? GST_WEBRTC_BUNDLE_POLICY_MAX_BUNDLE : GST_WEBRTC_BUNDLE_POLICY_MAX_COMPAT,
+        nullptr);
+
+    if(lite) {
+        // incoming media is never expected,
+        // so jitterbuffers of internal rtpbin shouldn't buffer or track lost packets
+        // "latency" is available since GStreamer 1.18 only
+        if(g_object_class_find_property(G_OBJECT_GET_CLASS(rtcbin), "latency"))
+            g_object_set(rtcbin, "latency", 0u, nullptr);
+
+        GstElementPtr rtpbinPtr(gst_bin_get_by_name(GST_BIN(rtcbin), "rtpbin"));
+        if(GstElement* rtpbin = rtpbinPtr.get()) {
+            g_object_set(rtpbin, "do-lost", FALSE, nullptr);
+            gst_util_set_object_arg(G_OBJECT(rtpbin), "buffer-mode", "none");
+        }
+    }
+
+    if(!webRTCConfig.dtlsCertificate.empty()) {
+        // dtls elements are created by webrtcbin only on demand,
+        // so certificate is injected right when they appear
+        auto onDeepElementAddedCallback =
+            + [] (GstBin*, GstBin*, GstElement* element, gpointer userData) {
+                GstElementFactory* factory = gst_element_get_factory(element);
+                if(factory && 0 == g_strcmp0(gst_plugin_feature_get_name(factory), "dtlssrtpdec"))
+                    g_object_set(element, "pem", static_cast<const gchar*>(userData), nullptr);
+            };
+        g_signal_connect_data(
+            rtcbin,
+            "deep-element-added",
+            G_CALLBACK(onDeepElementAddedCallback),
+            g_strdup(webRTCConfig.dtlsCertificate.c_str()),
+            [] (gpointer userData, GClosure*) { g_free(userData); },
+            G_CONNECT_DEFAULT);
+    }
+
+    if(IsIceAgentAvailable && IsMinMaxRtpPortAvailable) {
+        GstObject* iceAgent = nullptr;
+        g_object_get(rtcbin, "ice-agent", &iceAgent, NULL);
+        if(iceAgent) {
+            GstObjectPtr iceAgentPtr(iceAgent);
+
+            if(webRTCConfig.minRtpPort)
+                g_object_set(iceAgent, "min-rtp-port", webRTCConfig.minRtpPort.value(), nullptr);
+            if(webRTCConfig.maxRtpPort)
+                g_object_set(iceAgent, "max-rtp-port", webRTCConfig.maxRtpPort.value(), nullptr);
+        }
+    }
+
+    if(lite && IsIceAgentAvailable) {
+        GstObject* iceAgent = nullptr;
+        g_object_get(rtcbin, "ice-agent", &iceAgent, NULL);
+        if(iceAgent) {
+            GstObjectPtr iceAgentPtr(iceAgent);
+
+            // saves listening socket per component
+            if(g_object_class_find_property(G_OBJECT_GET_CLASS(iceAgent), "ice-tcp"))
+                g_object_set(iceAgent, "ice-tcp", FALSE, nullptr);
+        }
+    }
+
+    g_object_set_qdata(G_OBJECT(rtcbin), ConfiguredQuark(), GINT_TO_POINTER(TRUE));
+}
+
+namespace {
+
+guint64 GetCounter(const GstStructure* structure, const gchar* name)
+{
+    const GValue* value = gst_structure_get_value(structure, name);
+    if(!value)
+        return 0;
+
+    if(G_VALUE_HOLDS_UINT64(value))
+        return g_value_get_uint64(value);
+    else if(G_VALUE_HOLDS_UINT(value))
+        return g_value_get_uint(value);
+    else if(G_VALUE_HOLDS_INT64(value))
+        return std::max<gint64>(g_value_get_int64(value), 0);
+    else if(G_VALUE_HOLDS_INT(value))
+        return std::max<gint>(g_value_get_int(value), 0);
+    else
+        return 0;
+}
+
+void ParseStats(const GstStructure* reply, WebRTCPeer::Stats* stats)
+{
+    auto onField =
+        + [] (GQuark, const GValue* value, gpointer userData) -> gboolean {
+            WebRTCPeer::Stats* stats = static_cast<WebRTCPeer::Stats*>(userData);
+
+            if(!GST_VALUE_HOLDS_STRUCTURE(value))
+                return TRUE;
+
+            const GstStructure* structure = gst_value_get_structure(value);
+            GstWebRTCStatsType type;
+            if(!gst_structure_get_enum(structure, "type", GST_TYPE_WEBRTC_STATS_TYPE, reinterpret_cast<gint*>(&type)))
+                return TRUE;
+
+            switch(type) {
+            case GST_WEBRTC_STATS_OUTBOUND_RTP:
+                stats->packetsSent += GetCounter(structure, "packets-sent");
+                stats->bytesSent += GetCounter(structure, "bytes-sent");
+                stats->nackCount += GetCounter(structure, "nack-count");
+                stats->pliCount += GetCounter(structure, "pli-count");
+                stats->firCount += GetCounter(structure, "fir-count");
+                break;
+            case GST_WEBRTC_STATS_REMOTE_INBOUND_RTP: {
+                gint64 packetsLost = 0;
+                if(gst_structure_get_int64(structure, "packets-lost", &packetsLost))
+                    stats->packetsLost += packetsLost;
+
+                gdouble fractionLost = 0;
+                if(gst_structure_get_double(structure, "fraction-lost", &fractionLost))
+                    stats->fractionLost = std::max(stats->fractionLost, fractionLost);
+
+                gdouble roundTripTime = 0;
+                if(gst_structure_get_double(structure, "round-trip-time", &roundTripTime))
+                    stats->roundTripTime = std::max(stats->roundTripTime, roundTripTime);
+                break;
+            }
+            default:
+                break;
+            }
+
+            return TRUE;
+        };
+    gst_structure_foreach(reply, onField, stats);
+}
+
+}
+
+void GstWebRTCPeerBase::RequestStats(GstElement* rtcbin, const StatsCallback& callback) noexcept
+{
+    if(!rtcbin || !callback)
+        return;
+
+    auto onStatsCallback =
+        + [] (GstPromise* promise, gpointer userData) {
+            GstPromisePtr promisePtr(promise);
+
+            if(gst_promise_wait(promise) != GST_PROMISE_RESULT_REPLIED)
+                return;
+
+            const GstStructure* reply = gst_promise_get_reply(promise);
+            if(!reply)
+                return;
+
+            WebRTCPeer::Stats stats;
+            ParseStats(reply, &stats);
+
+            (*static_cast<StatsCallback*>(userData))(stats);
+        };
+
+    GstPromise* promise = gst_promise_new_with_change_func(
+        onStatsCallback,
+        new StatsCallback(callback),
+        [] (gpointer userData) { delete static_cast<StatsCallback*>(userData); });
+    g_signal_emit_by_name(rtcbin, "get-stats", nullptr, promise);
+}
+
+void GstWebRTCPeerBase::getStats(const StatsCallback& callback) noexcept
+{
+    RequestStats(webRtcBin(), callback);
+}
+
 GstElement* GstWebRTCPeerBase::webRtcBin() const noexcept
 {
     return _rtcbinPtr.get();
@@ -266,15 +467,16 @@ void GstWebRTCPeerBase::onPrepared()
 
 void GstWebRTCPeerBase::onEos(bool /*error*/)
 {
+    _finished = true;
+
     if(_eosCallback)
         _eosCallback();
 }
 
-// will be called from streaming thread
-void GstWebRTCPeerBase::setIceServers(const WebRTCConfig& webRTCConfig)
+void GstWebRTCPeerBase::SetIceServers(
+    const WebRTCConfig& webRTCConfig,
+    GstElement* rtcbin) noexcept
 {
-    GstElement* rtcbin = webRtcBin();
-
     for(const std::string& iceServer: webRTCConfig.iceServers) {
         using namespace GstRtStreaming;
         switch(ParseIceServerType(iceServer)) {
@@ -14,9 +14,20 @@
 class GstWebRTCPeerBase : public WebRTCPeer
 {
 public:
+    // thread safe
+    // everything in webrtcbin setup not depending on particular peer
+    static void ConfigureWebRtcBin(const WebRTCConfig&, GstElement* rtcbin) noexcept;
+    // thread safe
+    // callback is called from webrtcbin thread
+    static void RequestStats(GstElement* rtcbin, const StatsCallback&) noexcept;
+
     void addIceCandidate(unsigned mlineIndex, const std::string& candidate) noexcept override;
     const std::string& sdp() noexcept override;
 
+    void detachClient() noexcept override;
+
+    void getStats(const StatsCallback&) noexcept override;
+
 protected:
     static const bool MDNSResolveRequired;
     static const bool EndOfCandidatesSupported;
@@ -34,6 +45,15 @@ protected:
         const EosCallback&,
         const std::string& logContext) noexcept;
     bool clientAttached() const noexcept;
+    // replaces callbacks of already attached client
+    void reattachClient(
+        const PreparedCallback&,
+        const IceCandidateCallback&,
+        const EosCallback&,
+        const std::string& logContext) noexcept;
+    // eos was reported
+    bool finished() const noexcept
+        { return _finished; }
 
     void setPipeline(GstElement*) noexcept;
     virtual void setPipeline(GstElementPtr&&) noexcept;
@@ -61,12 +81,14 @@ protected:
     void onEos(bool /*error*/);
 
 private:
-    void setIceServers(const WebRTCConfig&);
+    static GQuark ConfiguredQuark() noexcept;
+    static void SetIceServers(const WebRTCConfig&, GstElement* rtcbin) noexcept;
 
 private:
     std::shared_ptr<spdlog::logger> _log = MakeGstRtStreamingMtLogger("GstWebRTCPeer");
 
     bool _clientAttached = false;
+    bool _finished = false;
 
     PreparedCallback _preparedCallback;
     IceCandidateCallback _iceCandidateCallback;
@@ -0,0 +1,238 @@
+#include "GstWebRtcBinPool.h"
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <gst/gst.h>
+
+#include "Log.h"
+#include "GstWebRTCPeerBase.h"
+
+
+namespace {
+
+// how often entries of destroyed configs are dropped
+const std::chrono::seconds SweepInterval(10);
+
+struct Entry
+{
+    std::weak_ptr<const WebRTCConfig> config;
+    std::deque<GstElementPtr> idle;
+    unsigned pending = 0;
+};
+
+GstElementPtr MakeWebRtcBin(const WebRTCConfig& config)
+{
+    GstElementPtr rtcbinPtr(gst_element_factory_make("webrtcbin", nullptr));
+    if(!rtcbinPtr)
+        return rtcbinPtr;
+
+    GstWebRTCPeerBase::ConfigureWebRtcBin(config, rtcbinPtr.get());
+
+    return rtcbinPtr;
+}
+
+void Discard(std::deque<GstElementPtr>* elements)
+{
+    for(GstElementPtr& elementPtr: *elements)
+        gst_element_set_state(elementPtr.get(), GST_STATE_NULL);
+    elements->clear();
+}
+
+}
+
+struct GstWebRtcBinPool::Private
+{
+    Private() noexcept;
+
+    void run() noexcept;
+
+    // should be called with mutex locked
+    Entry& entry(const WebRTCConfigPtr&, std::deque<GstElementPtr>* expired) noexcept;
+    bool refill(const WebRTCConfigPtr&, Entry*) noexcept;
+    void sweep(std::deque<GstElementPtr>* expired) noexcept;
+
+    const std::shared_ptr<spdlog::logger> log = MakeGstRtStreamingMtLogger("GstWebRtcBinPool");
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::map<const WebRTCConfig*, Entry> entries;
+    std::deque<WebRTCConfigPtr> requests;
+
+    Stats stats;
+};
+
+GstWebRtcBinPool::Private::Private() noexcept
+{
+    std::thread(&Private::run, this).detach();
+}
+
+void GstWebRtcBinPool::Private::run() noexcept
+{
+    for(;;) {
+        WebRTCConfigPtr config;
+
+        {
+            std::deque<GstElementPtr> expired;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait_for(lock, SweepInterval, [this] () { return !requests.empty(); });
+                sweep(&expired);
+                if(!requests.empty()) {
+                    config = std::move(requests.front());
+                    requests.pop_front();
+                }
+            }
+
+            Discard(&expired);
+        }
+
+        if(!config)
+            continue;
+
+        GstElementPtr rtcbinPtr = MakeWebRtcBin(*config);
+        if(rtcbinPtr &&
+            GST_STATE_CHANGE_FAILURE == gst_element_set_state(rtcbinPtr.get(), GST_STATE_READY))
+        {
+            log->error("Failed to switch webrtcbin to READY state");
+            rtcbinPtr.reset();
+        }
+
+        std::deque<GstElementPtr> expired;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Entry& entry = this->entry(config, &expired);
+            if(entry.pending)
+                --entry.pending;
+            if(rtcbinPtr) {
+                entry.idle.emplace_back(std::move(rtcbinPtr));
+                ++stats.idle;
+            }
+        }
+
+        Discard(&expired);
+    }
+}
+
+Entry& GstWebRtcBinPool::Private::entry(
+    const WebRTCConfigPtr& config,
+    std::deque<GstElementPtr>* expired) noexcept
+{
+    Entry& entry = entries[config.get()];
+
+    // address of destroyed config could be reused
+    if(entry.config.lock() != config) {
+        stats.idle -= entry.idle.size();
+        for(GstElementPtr& elementPtr: entry.idle)
+            expired->emplace_back(std::move(elementPtr));
+
+        entry = Entry();
+        entry.config = config;
+    }
+
+    return entry;
+}
+
+bool GstWebRtcBinPool::Private::refill(const WebRTCConfigPtr& config, Entry* entry) noexcept
+{
+    bool requested = false;
+    while(entry->idle.size() + entry->pending < config->webRtcBinPoolSize) {
+        ++entry->pending;
+        requests.emplace_back(config);
+        requested = true;
+    }
+
+    return requested;
+}
+
+void GstWebRtcBinPool::Private::sweep(std::deque<GstElementPtr>* expired) noexcept
+{
+    for(auto it = entries.begin(); it != entries.end();) {
+        Entry& entry = it->second;
+        if(!entry.config.expired()) {
+            ++it;
+            continue;
+        }
+
+        stats.idle -= entry.idle.size();
+        for(GstElementPtr& elementPtr: entry.idle)
+            expired->emplace_back(std::move(elementPtr));
+
+        it = entries.erase(it);
+    }
+}
+
+GstWebRtcBinPool::Private& GstWebRtcBinPool::Instance() noexcept
+{
+    // intentionally leaked: pool thread lives until process exit
+    static Private* instance = new Private();
+    return *instance;
+}
+
+void GstWebRtcBinPool::Prewarm(const WebRTCConfigPtr& config) noexcept
+{
+    if(!config || !config->webRtcBinPoolSize)
+        return;
+
+    Private& instance = Instance();
+
+    bool requested;
+    std::deque<GstElementPtr> expired;
+    {
+        std::lock_guard<std::mutex> lock(instance.mutex);
+        requested = instance.refill(config, &instance.entry(config, &expired));
+    }
+
+    Discard(&expired);
+
+    if(requested)
+        instance.condition.notify_one();
+}
+
+GstElementPtr GstWebRtcBinPool::Acquire(const WebRTCConfigPtr& config) noexcept
+{
+    if(!config || !config->webRtcBinPoolSize)
+        return config ? MakeWebRtcBin(*config) : GstElementPtr();
+
+    Private& instance = Instance();
+
+    GstElementPtr rtcbinPtr;
+    bool requested;
+    std::deque<GstElementPtr> expired;
+    {
+        std::lock_guard<std::mutex> lock(instance.mutex);
+
+        Entry& entry = instance.entry(config, &expired);
+        if(!entry.idle.empty()) {
+            rtcbinPtr = std::move(entry.idle.front());
+            entry.idle.pop_front();
+            --instance.stats.idle;
+            ++instance.stats.hits;
+        } else {
+            ++instance.stats.misses;
+        }
+
+        requested = instance.refill(config, &entry);
+    }
+
+    Discard(&expired);
+
+    if(requested)
+        instance.condition.notify_one();
+
+    if(!rtcbinPtr)
+        rtcbinPtr = MakeWebRtcBin(*config);
+
+    return rtcbinPtr;
+}
+
+GstWebRtcBinPool::Stats GstWebRtcBinPool::stats() noexcept
+{
+    Private& instance = Instance();
+
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    return instance.stats;
+}
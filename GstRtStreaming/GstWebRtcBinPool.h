@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CxxPtr/GstPtr.h"
+
+#include "../WebRTCConfig.h"
+
+
+// Keeps per WebRTCConfig set of idle webrtcbin instances
+// already configured and switched to GST_STATE_READY.
+// webrtcbin can't be reused after session,
+// so pool is refilled with fresh instances on dedicated thread.
+// Instances kept for destroyed WebRTCConfig are periodically released on the same thread
+class GstWebRtcBinPool
+{
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        unsigned idle = 0;
+    };
+
+    // thread safe
+    // fills pool up to WebRTCConfig::webRtcBinPoolSize in background
+    static void Prewarm(const WebRTCConfigPtr&) noexcept;
+
+    // thread safe
+    // returns configured webrtcbin, taken from pool if available
+    static GstElementPtr Acquire(const WebRTCConfigPtr&) noexcept;
+
+    // thread safe
+    static Stats stats() noexcept;
+
+private:
+    struct Private;
+    static Private& Instance() noexcept;
+};
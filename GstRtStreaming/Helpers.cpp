@@ -3,6 +3,7 @@
 #if !defined(_WIN32) && !_WIN32
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <sys/resource.h>
 #endif
 
 #include <gst/gst.h>
@@ -24,6 +25,21 @@ IceServerType ParseIceServerType(const std::string& iceServer)
         return IceServerType::Unknown;
 }
 
+gint64 ProcessCpuTime()
+{
+#if !defined(_WIN32) && !_WIN32
+    struct rusage usage;
+    if(0 != getrusage(RUSAGE_SELF, &usage))
+        return 0;
+
+    return
+        (gint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * G_USEC_PER_SEC +
+        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#else
+    return 0;
+#endif
+}
+
 bool IsMDNSResolveRequired()
 {
     guint vMajor = 0, vMinor = 0;
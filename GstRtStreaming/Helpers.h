@@ -19,6 +19,9 @@ bool IsIceAgentAvailable();
 bool IsMinMaxRtpPortAvailable();
 bool IsTimestamperAvailable();
 
+// user + system CPU time of whole process in microseconds (0 if not available)
+gint64 ProcessCpuTime();
+
 IceServerType ParseIceServerType(const std::string& iceServer);
 
 void TryResolveMDNSIceCandidate(
@@ -6,6 +6,10 @@
 struct _MessageProxy
 {
     GObject parent_instance;
+
+    MessageProxyEventHandler event_handler;
+    gpointer event_handler_data;
+    gpointer event_channel;
 };
 
 G_DEFINE_TYPE(MessageProxy, message_proxy, G_TYPE_OBJECT)
@@ -31,10 +35,37 @@ static void message_proxy_class_init(MessageProxyClass* klass)
 
 static void message_proxy_init(MessageProxy* self)
 {
-
+    self->event_handler = NULL;
+    self->event_handler_data = NULL;
+    self->event_channel = NULL;
 }
 
 MessageProxy* message_proxy_new()
 {
     return g_object_new(MESSAGE_PROXY_TYPE, NULL);
 }
+
+void message_proxy_set_event_handler(
+    MessageProxy* self,
+    MessageProxyEventHandler handler,
+    gpointer user_data)
+{
+    self->event_handler = handler;
+    self->event_handler_data = user_data;
+}
+
+void message_proxy_dispatch_event(MessageProxy* self, gconstpointer event)
+{
+    if(self->event_handler)
+        self->event_handler(event, self->event_handler_data);
+}
+
+void message_proxy_set_event_channel(MessageProxy* self, gpointer channel)
+{
+    self->event_channel = channel;
+}
+
+gpointer message_proxy_get_event_channel(MessageProxy* self)
+{
+    return self->event_channel;
+}
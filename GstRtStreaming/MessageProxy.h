@@ -10,6 +10,20 @@ G_DECLARE_FINAL_TYPE(MessageProxy, message_proxy, , MESSAGE_PROXY, GObject)
 
 MessageProxy* message_proxy_new();
 
+// direct receiver of events delivered by GstPeerEventChannel,
+// should be set, reset and invoked on owner context only
+typedef void (*MessageProxyEventHandler)(gconstpointer event, gpointer user_data);
+void message_proxy_set_event_handler(
+    MessageProxy*,
+    MessageProxyEventHandler handler,
+    gpointer user_data);
+void message_proxy_dispatch_event(MessageProxy*, gconstpointer event);
+
+// opaque GstPeerEventChannel owner's events are posted to,
+// should be set before any event is posted
+void message_proxy_set_event_channel(MessageProxy*, gpointer channel);
+gpointer message_proxy_get_event_channel(MessageProxy*);
+
 G_END_DECLS
 
 #ifdef __cplusplus
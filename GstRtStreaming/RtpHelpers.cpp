@@ -0,0 +1,240 @@
+#include "RtpHelpers.h"
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+
+namespace GstRtStreaming
+{
+
+namespace {
+
+enum class NalKind {
+    Key, // IDR/IRAP slice or parameter set frame can be decoded from
+    Slice,
+    Prefix, // SEI, AUD, PPS etc., doesn't tell anything about frame yet
+};
+
+NalKind H264NalKind(guint8 nalHeader)
+{
+    const guint8 nalType = nalHeader & 0x1f;
+    if(nalType == 5 || // IDR slice
+        nalType == 7)  // SPS
+    {
+        return NalKind::Key;
+    }
+
+    if(nalType >= 1 && nalType <= 4)
+        return NalKind::Slice;
+
+    return NalKind::Prefix;
+}
+
+NalKind H265NalKind(guint8 nalType)
+{
+    if((nalType >= 16 && nalType <= 21) || // IRAP slices (BLA, IDR, CRA)
+        nalType == 32 || // VPS
+        nalType == 33)   // SPS
+    {
+        return NalKind::Key;
+    }
+
+    if(nalType < 32) // VCL
+        return NalKind::Slice;
+
+    return NalKind::Prefix;
+}
+
+// the most significant kind of NAL units in packet
+NalKind Merge(NalKind kind, NalKind nalKind)
+{
+    if(kind == NalKind::Key || nalKind == NalKind::Key)
+        return NalKind::Key;
+
+    if(kind == NalKind::Slice || nalKind == NalKind::Slice)
+        return NalKind::Slice;
+
+    return NalKind::Prefix;
+}
+
+NalKind H264PacketKind(const guint8* payload, guint size)
+{
+    if(size < 1)
+        return NalKind::Prefix;
+
+    const guint8 nalType = payload[0] & 0x1f;
+    switch(nalType) {
+    case 24: { // STAP-A
+        NalKind kind = NalKind::Prefix;
+        guint offset = 1;
+        while(offset + 2 < size) {
+            const guint nalSize = (payload[offset] << 8) | payload[offset + 1];
+            offset += 2;
+            kind = Merge(kind, H264NalKind(payload[offset]));
+            offset += nalSize;
+        }
+        return kind;
+    }
+    case 28: { // FU-A
+        if(size < 2)
+            return NalKind::Prefix;
+
+        const NalKind kind = H264NalKind(payload[1]);
+        // frame can be decoded only from the start of fragmented NAL
+        if(kind == NalKind::Key && !(payload[1] & 0x80))
+            return NalKind::Slice;
+
+        return kind;
+    }
+    default:
+        return H264NalKind(payload[0]);
+    }
+}
+
+NalKind H265PacketKind(const guint8* payload, guint size)
+{
+    if(size < 2)
+        return NalKind::Prefix;
+
+    const guint8 nalType = (payload[0] >> 1) & 0x3f;
+    switch(nalType) {
+    case 48: { // AP
+        NalKind kind = NalKind::Prefix;
+        guint offset = 2;
+        while(offset + 2 < size) {
+            const guint nalSize = (payload[offset] << 8) | payload[offset + 1];
+            offset += 2;
+            kind = Merge(kind, H265NalKind((payload[offset] >> 1) & 0x3f));
+            offset += nalSize;
+        }
+        return kind;
+    }
+    case 49: { // FU
+        if(size < 3)
+            return NalKind::Prefix;
+
+        const NalKind kind = H265NalKind(payload[2] & 0x3f);
+        // frame can be decoded only from the start of fragmented NAL
+        if(kind == NalKind::Key && !(payload[2] & 0x80))
+            return NalKind::Slice;
+
+        return kind;
+    }
+    default:
+        return H265NalKind(nalType);
+    }
+}
+
+void SetNalKind(NalKind kind, RtpPacketInfo* info)
+{
+    info->keyFrame = kind == NalKind::Key;
+    info->prefixOnly = kind == NalKind::Prefix;
+}
+
+bool IsVP8KeyFrame(const guint8* payload, guint size)
+{
+    if(size < 1)
+        return false;
+
+    const bool start = payload[0] & 0x10;
+    const guint8 partitionId = payload[0] & 0x07;
+    if(!start || partitionId != 0)
+        return false;
+
+    guint offset = 1;
+    if(payload[0] & 0x80) { // extended control bits present
+        if(size < 2)
+            return false;
+
+        const guint8 extension = payload[1];
+        offset = 2;
+        if(extension & 0x80) { // picture id present
+            if(offset >= size)
+                return false;
+            offset += (payload[offset] & 0x80) ? 2 : 1;
+        }
+        if(extension & 0x40) // TL0PICIDX present
+            offset += 1;
+        if(extension & 0x30) // TID or KEYIDX present
+            offset += 1;
+    }
+
+    if(offset >= size)
+        return false;
+
+    // inverse key frame flag of VP8 payload header
+    return (payload[offset] & 0x01) == 0;
+}
+
+}
+
+RtpCodec ParseRtpCodec(const GstCaps* caps)
+{
+    if(!caps || gst_caps_is_empty(caps) || gst_caps_is_any(caps))
+        return RtpCodec::Unknown;
+
+    const GstStructure* structure = gst_caps_get_structure(caps, 0);
+    if(!gst_structure_has_name(structure, "application/x-rtp"))
+        return RtpCodec::Unknown;
+
+    const gchar* encodingName = gst_structure_get_string(structure, "encoding-name");
+    if(!encodingName)
+        return RtpCodec::Unknown;
+
+    if(0 == g_ascii_strcasecmp(encodingName, "H264"))
+        return RtpCodec::H264;
+    else if(0 == g_ascii_strcasecmp(encodingName, "H265"))
+        return RtpCodec::H265;
+    else if(0 == g_ascii_strcasecmp(encodingName, "VP8"))
+        return RtpCodec::VP8;
+    else
+        return RtpCodec::Unknown;
+}
+
+bool ParseRtpPacket(RtpCodec codec, GstBuffer* buffer, RtpPacketInfo* info)
+{
+    GstRTPBuffer rtpBuffer = GST_RTP_BUFFER_INIT;
+    if(!gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtpBuffer))
+        return false;
+
+    info->marker = gst_rtp_buffer_get_marker(&rtpBuffer);
+    info->timestamp = gst_rtp_buffer_get_timestamp(&rtpBuffer);
+
+    const guint8* payload = static_cast<const guint8*>(gst_rtp_buffer_get_payload(&rtpBuffer));
+    const guint size = gst_rtp_buffer_get_payload_len(&rtpBuffer);
+
+    switch(codec) {
+    case RtpCodec::H264:
+        SetNalKind(H264PacketKind(payload, size), info);
+        break;
+    case RtpCodec::H265:
+        SetNalKind(H265PacketKind(payload, size), info);
+        break;
+    case RtpCodec::VP8:
+        info->keyFrame = IsVP8KeyFrame(payload, size);
+        info->prefixOnly = false;
+        break;
+    case RtpCodec::Unknown:
+        info->keyFrame = false;
+        info->prefixOnly = false;
+        break;
+    }
+
+    gst_rtp_buffer_unmap(&rtpBuffer);
+
+    return true;
+}
+
+bool SetRtpTimestamp(GstBuffer* buffer, guint32 timestamp)
+{
+    GstRTPBuffer rtpBuffer = GST_RTP_BUFFER_INIT;
+    if(!gst_rtp_buffer_map(buffer, GST_MAP_READWRITE, &rtpBuffer))
+        return false;
+
+    gst_rtp_buffer_set_timestamp(&rtpBuffer, timestamp);
+
+    gst_rtp_buffer_unmap(&rtpBuffer);
+
+    return true;
+}
+
+}
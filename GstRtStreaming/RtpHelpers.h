@@ -0,0 +1,33 @@
+#pragma once
+
+#include <gst/gst.h>
+
+
+namespace GstRtStreaming
+{
+
+enum class RtpCodec {
+    Unknown,
+    H264,
+    H265,
+    VP8,
+};
+
+struct RtpPacketInfo {
+    bool marker = false; // last packet of frame
+    bool keyFrame = false; // frame can be decoded from this packet (if it's first slice of frame)
+    // packet has no slice, only NAL units which can precede one (SEI, AUD, PPS etc.),
+    // so it doesn't tell if frame is key one
+    bool prefixOnly = false;
+    guint32 timestamp = 0;
+};
+
+// based on "encoding-name" of "application/x-rtp" caps
+RtpCodec ParseRtpCodec(const GstCaps*);
+
+bool ParseRtpPacket(RtpCodec, GstBuffer*, RtpPacketInfo*);
+
+// expects writable buffer
+bool SetRtpTimestamp(GstBuffer*, guint32 timestamp);
+
+}
@@ -0,0 +1,338 @@
+#include "RtpSlabAllocator.h"
+
+#include <cstring>
+#include <mutex>
+#include <atomic>
+
+
+namespace {
+
+enum {
+    // RTP header only (payloaders usually share payload with input buffer)
+    SMALL_BLOCK_SIZE = 256,
+    // the whole packet up to usual MTU, with room for SRTP trailer and alignment
+    LARGE_BLOCK_SIZE = 2048,
+    // thread cache spills that many blocks to shared list at once
+    CACHE_BATCH = 64,
+    MAX_CACHED_BLOCKS = CACHE_BATCH * 4,
+};
+
+const gsize BlockSizes[] = { SMALL_BLOCK_SIZE, LARGE_BLOCK_SIZE };
+
+struct SlabMemory
+{
+    GstMemory mem;
+    guint8* data;
+    guint sizeClass; // G_N_ELEMENTS(BlockSizes) for memory shared from other one
+};
+
+// block is SlabMemory immediately followed by BlockSizes[sizeClass] bytes of data
+union Block
+{
+    Block* next; // while block is free
+    SlabMemory memory;
+};
+
+std::atomic<guint64> Allocations { 0 };
+std::atomic<guint64> CacheHits { 0 };
+std::atomic<guint64> Fallbacks { 0 };
+std::atomic<guint64> Blocks { 0 };
+std::atomic<guint64> BlocksInUse { 0 };
+
+// blocks released by threads which don't allocate (i.e. webrtcbin ones)
+// go to allocating threads through this list
+struct SharedList
+{
+    std::mutex mutex;
+    Block* blocks = nullptr;
+    guint count = 0;
+};
+SharedList SharedLists[G_N_ELEMENTS(BlockSizes)];
+
+struct ThreadCache
+{
+    ~ThreadCache() {
+        for(guint sizeClass = 0; sizeClass < G_N_ELEMENTS(BlockSizes); ++sizeClass)
+            spill(sizeClass, counts[sizeClass]);
+    }
+
+    Block* pop(guint sizeClass) {
+        if(!blocks[sizeClass])
+            refill(sizeClass);
+
+        Block* block = blocks[sizeClass];
+        if(!block)
+            return nullptr;
+
+        blocks[sizeClass] = block->next;
+        --counts[sizeClass];
+
+        return block;
+    }
+
+    void push(guint sizeClass, Block* block) {
+        block->next = blocks[sizeClass];
+        blocks[sizeClass] = block;
+        ++counts[sizeClass];
+
+        if(counts[sizeClass] > MAX_CACHED_BLOCKS)
+            spill(sizeClass, CACHE_BATCH);
+    }
+
+    void refill(guint sizeClass) {
+        SharedList& list = SharedLists[sizeClass];
+
+        std::lock_guard<std::mutex> lock(list.mutex);
+        for(guint i = 0; i < CACHE_BATCH && list.blocks; ++i) {
+            Block* block = list.blocks;
+            list.blocks = block->next;
+            --list.count;
+
+            block->next = blocks[sizeClass];
+            blocks[sizeClass] = block;
+            ++counts[sizeClass];
+        }
+    }
+
+    void spill(guint sizeClass, guint count) {
+        if(!count)
+            return;
+
+        Block* first = blocks[sizeClass];
+        Block* last = first;
+        for(guint i = 1; i < count; ++i)
+            last = last->next;
+
+        blocks[sizeClass] = last->next;
+        counts[sizeClass] -= count;
+
+        SharedList& list = SharedLists[sizeClass];
+
+        std::lock_guard<std::mutex> lock(list.mutex);
+        last->next = list.blocks;
+        list.blocks = first;
+        list.count += count;
+    }
+
+    Block* blocks[G_N_ELEMENTS(BlockSizes)] = {};
+    guint counts[G_N_ELEMENTS(BlockSizes)] = {};
+};
+
+thread_local ThreadCache Cache;
+
+Block* AcquireBlock(guint sizeClass)
+{
+    if(Block* block = Cache.pop(sizeClass)) {
+        ++CacheHits;
+        return block;
+    }
+
+    ++Blocks;
+
+    return static_cast<Block*>(g_malloc(sizeof(Block) + BlockSizes[sizeClass]));
+}
+
+guint8* BlockData(Block* block)
+{
+    return reinterpret_cast<guint8*>(block) + sizeof(Block);
+}
+
+}
+
+struct _RtpSlabAllocator
+{
+    GstAllocator parent_instance;
+
+    GstAllocator* sysmem;
+};
+
+G_DEFINE_TYPE(RtpSlabAllocator, rtp_slab_allocator, GST_TYPE_ALLOCATOR)
+
+// will be called from any thread
+static GstMemory* rtp_slab_allocator_alloc(
+    GstAllocator* allocator,
+    gsize size,
+    GstAllocationParams* params)
+{
+    RtpSlabAllocator* self = _RTP_SLAB_ALLOCATOR(allocator);
+
+    const gsize maxSize = params->prefix + size + params->padding;
+    // align is mask, and data can be shifted by up to that value to be aligned
+    const gsize required = maxSize + params->align;
+
+    guint sizeClass = 0;
+    while(sizeClass < G_N_ELEMENTS(BlockSizes) && BlockSizes[sizeClass] < required)
+        ++sizeClass;
+
+    if(sizeClass == G_N_ELEMENTS(BlockSizes)) {
+        ++Fallbacks;
+        return gst_allocator_alloc(self->sysmem, size, params);
+    }
+
+    Block* block = AcquireBlock(sizeClass);
+
+    ++Allocations;
+    ++BlocksInUse;
+
+    SlabMemory* memory = &block->memory;
+    memory->sizeClass = sizeClass;
+
+    guint8* data = BlockData(block);
+    if(const gsize shift = reinterpret_cast<guintptr>(data) & params->align)
+        data += params->align + 1 - shift;
+    memory->data = data;
+
+    gst_memory_init(
+        GST_MEMORY_CAST(memory),
+        params->flags,
+        allocator,
+        nullptr,
+        maxSize,
+        params->align,
+        params->prefix,
+        size);
+
+    if(params->prefix && (params->flags & GST_MEMORY_FLAG_ZERO_PREFIXED))
+        memset(data, 0, params->prefix);
+    if(params->padding && (params->flags & GST_MEMORY_FLAG_ZERO_PADDED))
+        memset(data + params->prefix + size, 0, params->padding);
+
+    return GST_MEMORY_CAST(memory);
+}
+
+// will be called from any thread
+static void rtp_slab_allocator_free(GstAllocator*, GstMemory* mem)
+{
+    SlabMemory* memory = reinterpret_cast<SlabMemory*>(mem);
+
+    if(memory->sizeClass == G_N_ELEMENTS(BlockSizes)) {
+        g_slice_free(SlabMemory, memory);
+        return;
+    }
+
+    --BlocksInUse;
+
+    Cache.push(memory->sizeClass, reinterpret_cast<Block*>(memory));
+}
+
+static gpointer rtp_slab_memory_map(GstMemory* mem, gsize, GstMapFlags)
+{
+    return reinterpret_cast<SlabMemory*>(mem)->data;
+}
+
+static void rtp_slab_memory_unmap(GstMemory*)
+{
+}
+
+static GstMemory* rtp_slab_memory_share(GstMemory* mem, gssize offset, gssize size)
+{
+    SlabMemory* memory = reinterpret_cast<SlabMemory*>(mem);
+
+    GstMemory* parent = mem->parent ? mem->parent : mem;
+
+    if(size == -1)
+        size = mem->size - offset;
+
+    SlabMemory* sharedMemory = g_slice_new(SlabMemory);
+    sharedMemory->data = memory->data;
+    sharedMemory->sizeClass = G_N_ELEMENTS(BlockSizes);
+
+    gst_memory_init(
+        GST_MEMORY_CAST(sharedMemory),
+        GstMemoryFlags(GST_MINI_OBJECT_FLAGS(parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY),
+        mem->allocator,
+        parent,
+        mem->maxsize,
+        mem->align,
+        mem->offset + offset,
+        size);
+
+    return GST_MEMORY_CAST(sharedMemory);
+}
+
+static GstMemory* rtp_slab_memory_copy(GstMemory* mem, gssize offset, gssize size)
+{
+    SlabMemory* memory = reinterpret_cast<SlabMemory*>(mem);
+
+    if(size == -1)
+        size = mem->size > gsize(offset) ? mem->size - offset : 0;
+
+    GstAllocationParams params;
+    gst_allocation_params_init(&params);
+    params.align = mem->align;
+
+    GstMemory* copy = gst_allocator_alloc(mem->allocator, size, &params);
+
+    GstMapInfo info;
+    if(gst_memory_map(copy, &info, GST_MAP_WRITE)) {
+        memcpy(info.data, memory->data + mem->offset + offset, size);
+        gst_memory_unmap(copy, &info);
+    }
+
+    return copy;
+}
+
+static gboolean rtp_slab_memory_is_span(GstMemory* mem1, GstMemory* mem2, gsize* offset)
+{
+    SlabMemory* memory1 = reinterpret_cast<SlabMemory*>(mem1);
+    SlabMemory* memory2 = reinterpret_cast<SlabMemory*>(mem2);
+
+    if(offset)
+        *offset = mem1->offset - mem1->parent->offset;
+
+    return memory1->data + mem1->offset + mem1->size == memory2->data + mem2->offset;
+}
+
+static void rtp_slab_allocator_finalize(GObject* object)
+{
+    RtpSlabAllocator* self = _RTP_SLAB_ALLOCATOR(object);
+
+    gst_object_unref(self->sysmem);
+
+    G_OBJECT_CLASS(rtp_slab_allocator_parent_class)->finalize(object);
+}
+
+static void rtp_slab_allocator_class_init(RtpSlabAllocatorClass* klass)
+{
+    GObjectClass* objectClass = G_OBJECT_CLASS(klass);
+    GstAllocatorClass* allocatorClass = GST_ALLOCATOR_CLASS(klass);
+
+    objectClass->finalize = rtp_slab_allocator_finalize;
+
+    allocatorClass->alloc = rtp_slab_allocator_alloc;
+    allocatorClass->free = rtp_slab_allocator_free;
+}
+
+static void rtp_slab_allocator_init(RtpSlabAllocator* self)
+{
+    GstAllocator* allocator = GST_ALLOCATOR_CAST(self);
+
+    self->sysmem = gst_allocator_find(GST_ALLOCATOR_SYSMEM);
+
+    allocator->mem_type = RTP_SLAB_ALLOCATOR_NAME;
+    allocator->mem_map = rtp_slab_memory_map;
+    allocator->mem_unmap = rtp_slab_memory_unmap;
+    allocator->mem_share = rtp_slab_memory_share;
+    allocator->mem_copy = rtp_slab_memory_copy;
+    allocator->mem_is_span = rtp_slab_memory_is_span;
+}
+
+void rtp_slab_allocator_install()
+{
+    GstAllocator* allocator =
+        GST_ALLOCATOR_CAST(g_object_new(RTP_SLAB_ALLOCATOR_TYPE, nullptr));
+    gst_object_ref_sink(allocator);
+
+    gst_allocator_register(RTP_SLAB_ALLOCATOR_NAME, gst_object_ref(allocator));
+    // blocks are cached per thread until process exit, so allocator is never released
+    gst_allocator_set_default(allocator);
+}
+
+void rtp_slab_allocator_get_stats(RtpSlabAllocatorStats* stats)
+{
+    stats->allocations = Allocations.load(std::memory_order_relaxed);
+    stats->cacheHits = CacheHits.load(std::memory_order_relaxed);
+    stats->fallbacks = Fallbacks.load(std::memory_order_relaxed);
+    stats->blocks = Blocks.load(std::memory_order_relaxed);
+    stats->blocksInUse = BlocksInUse.load(std::memory_order_relaxed);
+}
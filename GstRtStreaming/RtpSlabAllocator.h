@@ -0,0 +1,31 @@
+#pragma once
+
+#include <gst/gst.h>
+
+
+G_BEGIN_DECLS
+
+#define RTP_SLAB_ALLOCATOR_NAME "RtpSlabMemory"
+
+// allocator for packet sized memory: blocks of fixed size classes are kept in per thread caches
+// and are never returned to system, so steady stream of RTP packets doesn't touch malloc at all.
+// Bigger requests are passed to system memory allocator
+#define RTP_SLAB_ALLOCATOR_TYPE rtp_slab_allocator_get_type()
+G_DECLARE_FINAL_TYPE(RtpSlabAllocator, rtp_slab_allocator, , RTP_SLAB_ALLOCATOR, GstAllocator)
+
+typedef struct {
+    guint64 allocations; // served from slabs
+    guint64 cacheHits; // served with reused block
+    guint64 fallbacks; // too big for slab, passed to system memory allocator
+    guint64 blocks; // ever allocated from system, the rest are reused
+    guint64 blocksInUse;
+} RtpSlabAllocatorStats;
+
+// should be called after gst_init() and before any pipeline is created.
+// makes slab allocator default one for whole process
+void rtp_slab_allocator_install();
+
+// thread safe
+void rtp_slab_allocator_get_stats(RtpSlabAllocatorStats*);
+
+G_END_DECLS
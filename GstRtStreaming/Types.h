@@ -16,4 +16,20 @@ enum class IceServerType {
     Turns,
 };
 
+enum class PeerPriority {
+    Low,    // degraded first under load
+    Normal,
+    High,   // never degraded
+};
+
+enum class AdmissionResult {
+    Admitted,
+    PeerLimit,
+    CpuLimit,
+    EgressLimit,
+    ThreadLimit,
+    MemoryLimit,
+    SourceFailed, // admitted, but source failed to prepare
+};
+
 }
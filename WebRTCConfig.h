@@ -1,13 +1,23 @@
 #pragma once
 
 #include <cstdint>
+#include <chrono>
 #include <optional>
+#include <string>
 #include <vector>
 #include <memory>
 
 
 struct WebRTCConfig
 {
+    enum class PeerProfile {
+        Default,
+        // for viewers which never send media: max-bundle,
+        // no receive side buffering, no ICE TCP candidates and short fan out queue
+        SendOnlyLite,
+    };
+    PeerProfile peerProfile = PeerProfile::Default;
+
     typedef std::vector<std::string> IceServers;
     IceServers iceServers;
 
@@ -15,6 +25,20 @@ struct WebRTCConfig
     std::optional<uint16_t> maxRtpPort;
 
     bool useRelayTransport = false;
+
+    // PEM encoded certificate and private key used for DTLS by every peer.
+    // if empty, GStreamer generates one self signed certificate per process.
+    // to rotate, replace config: only peers created after that are affected
+    std::string dtlsCertificate;
+
+    // number of idle webrtcbin instances kept ready for new peers (0 = no pool)
+    unsigned webRtcBinPoolSize = 0;
+
+    // packets are sent to every peer at that multiple of stream bitrate,
+    // so key frames don't hit network as single burst (0 = no pacing).
+    // no packet is held longer than pacingMaxDelay
+    double pacingFactor = 0;
+    std::chrono::milliseconds pacingMaxDelay { 50 };
 };
 
 typedef std::shared_ptr<const WebRTCConfig> WebRTCConfigPtr;
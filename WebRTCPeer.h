@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <functional>
 #include <deque>
@@ -12,10 +13,25 @@ struct WebRTCPeer
 {
     virtual ~WebRTCPeer() {}
 
+    // callbacks are called on thread running context of peer's owner
+    // (GstStreamingSource::context() for GStreamer based peers)
     typedef std::function<void ()> PreparedCallback;
     typedef std::function<
         void (unsigned mlineIndex, const std::string& candidate)> IceCandidateCallback;
     typedef std::function<void ()> EosCallback;
+
+    // summed over all sent streams
+    struct Stats {
+        double roundTripTime = -1; // seconds, -1 if not reported by remote side yet
+        double fractionLost = 0; // as reported in last receiver report
+        int64_t packetsLost = 0;
+        uint64_t packetsSent = 0;
+        uint64_t bytesSent = 0;
+        uint64_t nackCount = 0;
+        uint64_t pliCount = 0;
+        uint64_t firCount = 0;
+    };
+    typedef std::function<void (const Stats&)> StatsCallback;
     virtual void prepare(
         const WebRTCConfigPtr&, // FIXME? is it too expensive to use std::shared_ptr here?
         const PreparedCallback&,
@@ -32,4 +48,23 @@ struct WebRTCPeer
 
     virtual void play() noexcept = 0;
     virtual void stop() noexcept = 0;
+
+    // stop sending media, but keep session alive
+    virtual void pause() noexcept {}
+    virtual void resume() noexcept {}
+
+    // callbacks passed to prepare() are not called anymore
+    virtual void detachClient() noexcept {}
+
+    // callback is called from internal thread, and not called at all if stats are not available
+    virtual void getStats(const StatsCallback&) noexcept {}
+
+    // renegotiates transport only, media path is kept.
+    // callbacks replace ones passed to prepare(), new offer is reported via PreparedCallback.
+    // returns false if not supported or peer is already finished
+    virtual bool restartIce(
+        const PreparedCallback&,
+        const IceCandidateCallback&,
+        const EosCallback&,
+        const std::string& /*logContext*/) noexcept { return false; }
 };